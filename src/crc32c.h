@@ -0,0 +1,137 @@
+#ifndef IO_BENCHMARK_CRC32C_H
+#define IO_BENCHMARK_CRC32C_H
+
+// CRC32C (Castagnoli). On x86-64 with SSE4.2 and PCLMUL, buffers are split
+// into three streams hashed with interleaved crc32 instructions, which hides
+// the instruction's latency, and stream results are shifted into place with
+// one carry-less multiply each. Other CPUs use a byte table.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define CRC32C_POLY 0x82f63b78u // reflected
+#define CRC32C_STREAM 512 // bytes of each of three interleaved streams
+
+static uint32_t crc32c_table [256];
+static uint64_t crc32c_shift_1; // x^(8 * CRC32C_STREAM - 33) mod P, shifts by one stream
+static uint64_t crc32c_shift_2; // same for two streams
+static int crc32c_hw = 0;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+// product of polynomials a and b modulo P, bit 31 being x^0
+static inline uint32_t crc32c_multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if (!(a & (m - 1))) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+// x^n modulo P
+static inline uint32_t crc32c_xnmodp(uint64_t n) {
+    uint32_t result = 1u << 31;
+    uint32_t power = 1u << 30;
+    while (n) {
+        if (n & 1) {
+            result = crc32c_multmodp(power, result);
+        }
+        power = crc32c_multmodp(power, power);
+        n >>= 1;
+    }
+    return result;
+}
+
+static inline void crc32c_init_once() {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = c & 1 ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        }
+        crc32c_table[i] = c;
+    }
+    // carry-less product of reflected values gains x^1 and crc32 of it adds x^32
+    crc32c_shift_1 = crc32c_xnmodp(8 * CRC32C_STREAM - 33);
+    crc32c_shift_2 = crc32c_xnmodp(2 * 8 * CRC32C_STREAM - 33);
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    crc32c_hw = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul");
+#endif
+}
+
+static inline void crc32c_init() {
+    pthread_once(&crc32c_once, &crc32c_init_once);
+}
+
+// state is not inverted
+static inline uint32_t crc32c_sw(uint32_t state, const unsigned char * p, size_t length) {
+    while (length--) {
+        state = crc32c_table[(state ^ *p++) & 0xff] ^ (state >> 8);
+    }
+    return state;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2,pclmul")))
+static inline uint32_t crc32c_shift(uint32_t state, uint64_t constant) {
+    __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(state), _mm_cvtsi64_si128(constant), 0);
+    return (uint32_t) _mm_crc32_u64(0, _mm_cvtsi128_si64(product));
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static inline uint32_t crc32c_x86(uint32_t state, const unsigned char * p, size_t length) {
+    uint64_t c0 = state;
+    while (length >= 3 * CRC32C_STREAM) {
+        uint64_t c1 = 0;
+        uint64_t c2 = 0;
+        for (size_t i = 0; i < CRC32C_STREAM; i += 8) {
+            uint64_t w0;
+            uint64_t w1;
+            uint64_t w2;
+            memcpy(&w0, p + i, 8);
+            memcpy(&w1, p + CRC32C_STREAM + i, 8);
+            memcpy(&w2, p + 2 * CRC32C_STREAM + i, 8);
+            c0 = _mm_crc32_u64(c0, w0);
+            c1 = _mm_crc32_u64(c1, w1);
+            c2 = _mm_crc32_u64(c2, w2);
+        }
+        c0 = crc32c_shift((uint32_t) c0, crc32c_shift_2) ^ crc32c_shift((uint32_t) c1, crc32c_shift_1) ^ c2;
+        p += 3 * CRC32C_STREAM;
+        length -= 3 * CRC32C_STREAM;
+    }
+    for (; length >= 8; p += 8, length -= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        c0 = _mm_crc32_u64(c0, w);
+    }
+    uint32_t c = (uint32_t) c0;
+    for (; length; ++p, --length) {
+        c = _mm_crc32_u8(c, *p);
+    }
+    return c;
+}
+#endif
+
+// continues crc of previous bytes (0 for none) over buffer; crc32c_init must be called first
+static inline uint32_t crc32c(uint32_t crc, const void * buf, size_t length) {
+#if defined(__x86_64__)
+    if (crc32c_hw) {
+        return ~crc32c_x86(~crc, buf, length);
+    }
+#endif
+    return ~crc32c_sw(~crc, buf, length);
+}
+
+#endif
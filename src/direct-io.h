@@ -0,0 +1,62 @@
+#ifndef IO_BENCHMARK_DIRECT_IO_H
+#define IO_BENCHMARK_DIRECT_IO_H
+
+// Helpers for O_DIRECT: alignment requirements and aligned buffers.
+// Requires _GNU_SOURCE to be defined before the first include.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define DIRECT_IO_FALLBACK_ALIGNMENT 512
+#define BUFFER_POOL_MIN_ALIGNMENT 4096
+
+static inline long read_long_from_file(const char * path) {
+    FILE * f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    long value = -1;
+    if (fscanf(f, "%ld", &value) != 1) {
+        value = -1;
+    }
+    fclose(f);
+    return value;
+}
+
+// returns offset and length alignment required by O_DIRECT for file
+static inline long direct_io_alignment(const char * file_path) {
+    struct statx stx;
+    if (statx(AT_FDCWD, file_path, 0, STATX_DIOALIGN, &stx) == 0) {
+        if ((stx.stx_mask & STATX_DIOALIGN) && stx.stx_dio_offset_align) {
+            return stx.stx_dio_offset_align;
+        }
+        // old kernel: ask the backing device (partitions have queue in parent)
+        char path [128];
+        sprintf(path, "/sys/dev/block/%u:%u/queue/logical_block_size", stx.stx_dev_major, stx.stx_dev_minor);
+        long size = read_long_from_file(path);
+        if (size <= 0) {
+            sprintf(path, "/sys/dev/block/%u:%u/../queue/logical_block_size", stx.stx_dev_major, stx.stx_dev_minor);
+            size = read_long_from_file(path);
+        }
+        if (size > 0) {
+            return size;
+        }
+    }
+    return DIRECT_IO_FALLBACK_ALIGNMENT;
+}
+
+// allocates count buffers of buf_size bytes in one aligned region; free() it
+static inline void * buffer_pool_alloc(int count, long buf_size, long alignment) {
+    if (alignment < BUFFER_POOL_MIN_ALIGNMENT) {
+        alignment = BUFFER_POOL_MIN_ALIGNMENT;
+    }
+    void * pool;
+    if (posix_memalign(&pool, alignment, (size_t) count * buf_size)) {
+        return 0;
+    }
+    return pool;
+}
+
+#endif
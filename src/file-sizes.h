@@ -0,0 +1,212 @@
+#ifndef IO_BENCHMARK_FILE_SIZES_H
+#define IO_BENCHMARK_FILE_SIZES_H
+
+// File size picker for filebomb writers: uniform range, lognormal with
+// mu and sigma of natural log of size, or empirical histogram loaded from
+// a file. Results are broken down by power of two size buckets.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "random.h"
+
+#define FILE_SIZES_FIXED 0
+#define FILE_SIZES_UNIFORM 1
+#define FILE_SIZES_LOGNORMAL 2
+#define FILE_SIZES_HISTOGRAM 3
+
+#define MAX_SIZE_BINS 1024
+#define MAX_FILE_SIZE (1L << 30) // every writer keeps buffer of largest size
+#define LOGNORMAL_CAP_SIGMAS 4 // lognormal sizes are capped at exp(mu + 4 sigma)
+#define SIZE_BUCKETS 41 // bucket 0 holds empty files, bucket k holds sizes [2^(k-1), 2^k)
+
+struct file_sizes {
+    int type;
+    long min; // uniform
+    long max; // largest size ever picked
+    double mu;
+    double sigma;
+    int bins_count;
+    long bin_sizes [MAX_SIZE_BINS]; // upper bound of bin; lower bound is previous bin's one
+    double bin_cdf [MAX_SIZE_BINS];
+};
+
+// accepts number with optional K, M or G ending; returns -1 on error
+static inline long parse_file_size(const char * s, char ** end) {
+    long result = strtol(s, end, 10);
+    if (*end == s) {
+        return -1;
+    }
+    switch (**end)
+    {
+    case 'k': case 'K':
+        result *= 1024;
+        ++*end;
+        break;
+    case 'm': case 'M':
+        result *= 1024 * 1024;
+        ++*end;
+        break;
+    case 'g': case 'G':
+        result *= 1024 * 1024 * 1024L;
+        ++*end;
+        break;
+    default:
+        break;
+    }
+    return result;
+}
+
+// reads lines of SIZE WEIGHT with sizes ascending; # starts comment
+static inline int file_sizes_load(struct file_sizes * sizes, const char * path) {
+    FILE * file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Can't open size histogram %s\n", path);
+        return -1;
+    }
+    char line [256];
+    double total = 0;
+    int status = 0;
+    sizes->bins_count = 0;
+    while (!status && fgets(line, sizeof(line), file)) {
+        char * s = line + strspn(line, " \t");
+        if (*s == '#' || *s == '\n' || !*s) {
+            continue;
+        }
+        char * end;
+        long size = parse_file_size(s, &end);
+        double weight = strtod(end, &end);
+        if (size < 0 || size > MAX_FILE_SIZE || weight < 0 || sizes->bins_count == MAX_SIZE_BINS
+            || (sizes->bins_count && size <= sizes->bin_sizes[sizes->bins_count - 1])) {
+            fprintf(stderr, "Bad line in size histogram %s: %s", path, line);
+            status = -1;
+            break;
+        }
+        total += weight;
+        sizes->bin_sizes[sizes->bins_count] = size;
+        sizes->bin_cdf[sizes->bins_count] = total;
+        sizes->bins_count++;
+    }
+    fclose(file);
+    if (!status && total <= 0) {
+        fprintf(stderr, "Size histogram %s has no weight\n", path);
+        status = -1;
+    }
+    for (int i = 0; !status && i < sizes->bins_count; ++i) {
+        sizes->bin_cdf[i] /= total;
+    }
+    if (!status) {
+        sizes->max = sizes->bin_sizes[sizes->bins_count - 1];
+    }
+    return status;
+}
+
+// accepts uniform:MIN-MAX, lognormal:MU/SIGMA and histogram:PATH; returns 0 on success
+static inline int parse_file_sizes(const char * s, struct file_sizes * sizes) {
+    memset(sizes, 0, sizeof(*sizes));
+    char * end;
+    if (!strncmp(s, "uniform:", 8)) {
+        sizes->type = FILE_SIZES_UNIFORM;
+        sizes->min = parse_file_size(s + 8, &end);
+        if (*end != '-') {
+            return -1;
+        }
+        sizes->max = parse_file_size(end + 1, &end);
+        return !*end && sizes->min >= 0 && sizes->max >= sizes->min && sizes->max <= MAX_FILE_SIZE ? 0 : -1;
+    }
+    if (!strncmp(s, "lognormal:", 10)) {
+        sizes->type = FILE_SIZES_LOGNORMAL;
+        if (sscanf(s + 10, "%lf/%lf", &sizes->mu, &sizes->sigma) != 2 || sizes->sigma < 0) {
+            return -1;
+        }
+        double max = exp(sizes->mu + LOGNORMAL_CAP_SIGMAS * sizes->sigma);
+        if (max < 1 || max > MAX_FILE_SIZE) {
+            return -1;
+        }
+        sizes->max = (long) max;
+        return 0;
+    }
+    if (!strncmp(s, "histogram:", 10)) {
+        sizes->type = FILE_SIZES_HISTOGRAM;
+        return file_sizes_load(sizes, s + 10);
+    }
+    return -1;
+}
+
+// expected size; sets count of files for total size
+static inline double file_sizes_mean(const struct file_sizes * sizes) {
+    switch (sizes->type)
+    {
+    case FILE_SIZES_UNIFORM:
+        return (sizes->min + sizes->max) / 2.0;
+    case FILE_SIZES_LOGNORMAL:
+        return exp(sizes->mu + sizes->sigma * sizes->sigma / 2);
+    case FILE_SIZES_HISTOGRAM:
+    {
+        double mean = 0;
+        double previous_cdf = 0;
+        long previous_size = 0;
+        for (int i = 0; i < sizes->bins_count; ++i) {
+            long low = i ? previous_size + 1 : 0;
+            mean += (sizes->bin_cdf[i] - previous_cdf) * (low + sizes->bin_sizes[i]) / 2.0;
+            previous_cdf = sizes->bin_cdf[i];
+            previous_size = sizes->bin_sizes[i];
+        }
+        return mean;
+    }
+    default:
+        return sizes->max;
+    }
+}
+
+static inline long file_sizes_next(const struct file_sizes * sizes, struct rng * rng) {
+    switch (sizes->type)
+    {
+    case FILE_SIZES_UNIFORM:
+        return sizes->min + (long) rng_below(rng, sizes->max - sizes->min + 1);
+    case FILE_SIZES_LOGNORMAL:
+    {
+        // Box-Muller; 1 - u keeps log argument above zero
+        double z = sqrt(-2 * log(1 - rng_double(rng))) * cos(2 * M_PI * rng_double(rng));
+        double size = exp(sizes->mu + sizes->sigma * z);
+        return size > sizes->max ? sizes->max : (long) size;
+    }
+    case FILE_SIZES_HISTOGRAM:
+    {
+        double u = rng_double(rng);
+        int i = 0;
+        while (i < sizes->bins_count - 1 && sizes->bin_cdf[i] <= u) {
+            ++i;
+        }
+        long low = i ? sizes->bin_sizes[i - 1] + 1 : 0;
+        return low + (long) rng_below(rng, sizes->bin_sizes[i] - low + 1);
+    }
+    default:
+        return sizes->max;
+    }
+}
+
+static inline int size_bucket(uint64_t size) {
+    int bucket = size ? 64 - __builtin_clzll(size) : 0;
+    return bucket < SIZE_BUCKETS ? bucket : SIZE_BUCKETS - 1;
+}
+
+// smallest size that falls into bucket
+static inline uint64_t size_bucket_min(int bucket) {
+    return bucket ? 1ull << (bucket - 1) : 0;
+}
+
+// writes size as B, KiB, MiB or GiB
+static inline void format_file_size(uint64_t size, char * s) {
+    static const char * units [] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    int unit = 0;
+    while (unit < 4 && size >= 1024 && size % 1024 == 0) {
+        size /= 1024;
+        ++unit;
+    }
+    sprintf(s, "%llu %s", (unsigned long long) size, units[unit]);
+}
+
+#endif
@@ -1,28 +1,28 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include <stdint.h>
-#include <dirent.h>
-#include <string.h>
+#include "filebomb-worker.h"
 
-#define BLOCK_SIZE 512
-
-static char * folder_path = 0;
 static int help_required = 0;
 
 static struct option opts [] = {
     {"folder", required_argument, 0, 'f'},
+    {"file-size", required_argument, 0, 'b'},
+    {"noatime", no_argument, 0, 'N'},
+    {"uring", required_argument, 0, 'u'},
+    FILEBOMB_TREE_LONG_OPTIONS,
     {"help", no_argument, 0, 'h'},
     {0, 0, 0, 0}
 };
 
 int main(int argc, char * argv []) {
+    struct filebomb_job job;
+    filebomb_job_init(&job);
     // read args
     int opt_c;
     int opt_i;
-    while ((opt_c = getopt_long(argc, argv, "f:h", opts, &opt_i)) != -1)
+    while ((opt_c = getopt_long(argc, argv, "f:b:Nu:" FILEBOMB_TREE_SHORT_OPTIONS "h", opts, &opt_i)) != -1)
     {
         switch (opt_c)
         {
@@ -31,12 +31,22 @@ int main(int argc, char * argv []) {
             return 1;
             break;
         case 'f':
-            folder_path = optarg;
+            job.folder_path = optarg;
+            break;
+        case 'b':
+            job.file_size = atoi(optarg);
+            break;
+        case 'N':
+            job.flag_noatime = 1;
+            break;
+        case 'u':
+            job.uring_files = atoi(optarg);
             break;
         case 'h':
             help_required = 1;
             break;
         default:
+            filebomb_job_parse_tree_option(&job, opt_c, optarg);
             break;
         }
     }
@@ -45,50 +55,32 @@ int main(int argc, char * argv []) {
         printf("IO benchmark filebomb reader\n");
         printf("This utility reads lots of small files in folder.\n");
         printf("--folder PATH | -f PATH sets path to folder to write (required argument)\n");
+        printf("--file-size SIZE | -b SIZE sets initial read buffer size; with io_uring files are read up to SIZE bytes. Default value is %d\n", DEFAULT_FILE_SIZE);
+        printf("--noatime | -N opens files with O_NOATIME (owner or root only; otherwise ignored)\n");
+        printf("--uring FILES | -u FILES keeps FILES files in flight with io_uring (linked open, read and close). Default is blocking calls\n");
+        filebomb_tree_print_help();
         printf("--help | -h shows this tip\n");
         return 0;
     }
     // check options
-    if (!folder_path) {
-        fprintf(stderr, "Folder path was not set. See help\n");
+    if (filebomb_job_check_tree(&job)) {
+        return 2;
+    }
+    if (job.uring_files < 0 || job.uring_files > MAX_URING_FILES) {
+        fprintf(stderr, "Count of files in flight was not set properly. See help\n");
         return 2;
     }
-    // vars
-    DIR* dir_fd;
-    struct dirent* in_file;
-    int fd;
-    void * buf = malloc(BLOCK_SIZE);
-    ssize_t read_bytes;
-    char file_path [512];
-    // scanning directory
-    dir_fd = opendir(folder_path);
-    if (dir_fd == NULL) {
-        fprintf(stderr, "Can't open folder %s\n", folder_path);
-        return 3;
+    if (!job.folder_path) {
+        fprintf(stderr, "Folder path was not set. See help\n");
+        return 2;
     }
-    // reading files
-    while ((in_file = readdir(dir_fd))) {
-        if (!strcmp (in_file->d_name, "."))
-            continue;
-        if (!strcmp (in_file->d_name, ".."))    
-            continue;
-        sprintf(file_path, "%s/%s", folder_path, in_file->d_name);
-        fd = open(file_path, O_RDONLY);
-        if (fd == -1) {
-            fprintf(stderr, "Can't open file %s\n", file_path);
-            continue;
-        }
-        do
-        {
-            read_bytes = read(fd, buf, BLOCK_SIZE);
-        } while (read_bytes == BLOCK_SIZE);
-        if (read_bytes == -1) {
-            fprintf(stderr, "Error while reading file %s\n", file_path);
-            return 6;
-        }
-        close(fd);
+    // read files
+    struct filebomb_result * result = malloc(sizeof(struct filebomb_result));
+    int status = filebomb_job_read(&job, 0, result);
+    if (!status) {
+        histogram_print("Read", &result->latency);
+        filebomb_result_print_sizes("Read", result);
     }
-    free(buf);
-    closedir(dir_fd);
-    return 0;
+    free(result);
+    return status;
 }
@@ -1,33 +1,33 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include <stdint.h>
+#include "filebomb-worker.h"
 
-#define DEFAULT_FILE_SIZE 512
-#define DEFAULT_SOURCE_PATH "/dev/urandom"
-
-static char * folder_path = 0;
-static char * source_path = DEFAULT_SOURCE_PATH;
-static int file_size = DEFAULT_FILE_SIZE;
 static int help_required = 0;
-static long files_count = 0;
+static struct file_sizes sizes;
 
 static struct option opts [] = {
     {"folder", required_argument, 0, 'f'},
     {"source", required_argument, 0, 's'},
     {"file-size", required_argument, 0, 'b'},
+    {"size-distribution", required_argument, 0, 'Z'},
     {"count", required_argument, 0, 'c'},
+    {"compress", required_argument, 0, 'z'},
+    {"dedupe", required_argument, 0, 'D'},
+    {"uring", required_argument, 0, 'u'},
+    FILEBOMB_TREE_LONG_OPTIONS,
     {"help", no_argument, 0, 'h'},
     {0, 0, 0, 0}
 };
 
 int main(int argc, char * argv []) {
+    struct filebomb_job job;
+    filebomb_job_init(&job);
     // read args
     int opt_c;
     int opt_i;
-    while ((opt_c = getopt_long(argc, argv, "f:s:b:c:h", opts, &opt_i)) != -1)
+    while ((opt_c = getopt_long(argc, argv, "f:s:b:Z:c:z:D:u:" FILEBOMB_TREE_SHORT_OPTIONS "h", opts, &opt_i)) != -1)
     {
         switch (opt_c)
         {
@@ -36,21 +36,38 @@ int main(int argc, char * argv []) {
             return 1;
             break;
         case 'f':
-            folder_path = optarg;
+            job.folder_path = optarg;
             break;
         case 's':
-            source_path = optarg;
+            job.source_path = optarg;
             break;
         case 'b':
-            file_size = atoi(optarg);
+            job.file_size = atoi(optarg);
+            break;
+        case 'Z':
+            if (parse_file_sizes(optarg, &sizes)) {
+                fprintf(stderr, "Size distribution was not set properly. See help\n");
+                return 1;
+            }
+            job.sizes = &sizes;
             break;
         case 'c':
-            files_count = atol(optarg);
+            job.files_count = atol(optarg);
+            break;
+        case 'z':
+            job.compress_percent = atoi(optarg);
+            break;
+        case 'D':
+            job.dedupe_percent = atoi(optarg);
+            break;
+        case 'u':
+            job.uring_files = atoi(optarg);
             break;
         case 'h':
             help_required = 1;
             break;
         default:
+            filebomb_job_parse_tree_option(&job, opt_c, optarg);
             break;
         }
     }
@@ -59,51 +76,62 @@ int main(int argc, char * argv []) {
         printf("IO benchmark filebomb writer\n");
         printf("This utility writes lots of small files in folder.\n");
         printf("--folder PATH | -f PATH sets path to folder to write (required argument)\n");
-        printf("--source PATH | -s PATH sets the source of bytes. Default value is %s\n", DEFAULT_SOURCE_PATH);
+        printf("--source PATH | -s PATH makes writer read bytes from PATH (e.g. /dev/urandom) instead of generating them\n");
         printf("--file-size SIZE | -b SIZE sets files size. Default value is %d\n", DEFAULT_FILE_SIZE);
+        printf("--size-distribution DIST | -Z DIST picks size of every file from DIST: uniform:MIN-MAX, lognormal:MU/SIGMA (of natural log of size in bytes; capped at exp(MU + %d SIGMA)) or histogram:PATH (lines of SIZE WEIGHT with sizes ascending)\n", LOGNORMAL_CAP_SIGMAS);
         printf("--count COUNT | -c COUNT sets count of files to write\n");
+        printf("--compress PERCENT | -z PERCENT makes written data compressible: PERCENT of bytes are zeros. Default value is 0\n");
+        printf("--dedupe PERCENT | -D PERCENT makes PERCENT of written 4 KiB chunks duplicates of each other. Default value is 0\n");
+        printf("--uring FILES | -u FILES keeps FILES files in flight with io_uring (linked open, write and close). Default is blocking calls\n");
+        filebomb_tree_print_help();
         printf("--help | -h shows this tip\n");
         return 0;
     }
     // check options
-    if (!folder_path) {
+    if (filebomb_job_check_tree(&job)) {
+        return 2;
+    }
+    if (job.uring_files < 0 || job.uring_files > MAX_URING_FILES) {
+        fprintf(stderr, "Count of files in flight was not set properly. See help\n");
+        return 2;
+    }
+    if (!job.folder_path) {
         fprintf(stderr, "Folder path was not set. See help\n");
         return 2;
     }
-    if (file_size <= 0) {
+    if (job.file_size <= 0) {
         fprintf(stderr, "File size was not set properly. See help\n");
         return 3;
     }
-    if (files_count <= 0) {
+    if (job.files_count <= 0) {
         fprintf(stderr, "Files count was not set properly. See help\n");
         return 3;
     }
-    // open source
-    int source_fd = open(source_path, O_RDONLY);
-    if (source_fd == -1) {
-        fprintf(stderr, "Can't open source %s\n", source_path);
-        return 10;
+    if (job.compress_percent < 0 || job.compress_percent > 100 || job.dedupe_percent < 0 || job.dedupe_percent > 100) {
+        fprintf(stderr, "Compressibility and dedupe ratio must be percents. See help\n");
+        return 3;
+    }
+    if (job.sizes) {
+        // buffer fits the largest file
+        job.file_size = sizes.max;
     }
     // write files
-    void * buf = malloc(file_size);
-    char file_path [512];
-    for (long i = 0; i < files_count; ++i) {
-        sprintf(file_path, "%s/%ld.bin", folder_path, i);
-        int fd = open(file_path, O_WRONLY | O_CREAT, 0644);
-        if (fd == -1) {
-            fprintf(stderr, "Can't open file %s\n", file_path);
-            return 4;
-        }
-        if (read(source_fd, buf, file_size) != file_size) {
-            fprintf(stderr, "Error while reading source %s\n", source_path);
-            return 11;
+    job.seed = random_seed();
+    struct filebomb_result * result = malloc(sizeof(struct filebomb_result));
+    int status = 0;
+    if (job.depth > 0) {
+        status = filebomb_job_mkdir(&job, 0, result);
+        if (!status) {
+            histogram_print("Mkdir", &result->latency);
         }
-        if (write(fd, buf, file_size) != file_size) {
-            fprintf(stderr, "Error while writing file %s\n", file_path);
-            return 6;
-        }
-        close(fd);
     }
-    free(buf);
-    return 0;
+    if (!status) {
+        status = filebomb_job_write(&job, 0, result);
+    }
+    if (!status) {
+        histogram_print("Create", &result->latency);
+        filebomb_result_print_sizes("Create", result);
+    }
+    free(result);
+    return status;
 }
@@ -1,32 +1,63 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/wait.h>
 #include <time.h>
 #include <string.h>
-#include <assert.h>
+#include "filebomb-worker.h"
+#include "report.h"
+#include "page-cache.h"
+#include "kernel-stats.h"
 
-#define WRITER_PATH "build/filebomb-benchmark-writer"
-#define READER_PATH "build/filebomb-benchmark-reader"
-
-#define DEFAULT_FILE_SIZE 512
 #define DEFAULT_PROCESSES_COUNT 1
 
 static char * folder_path = 0;
 static long total_size = 0;
 static long file_size = DEFAULT_FILE_SIZE;
+static struct file_sizes file_sizes;
+static int flag_sizes = 0;
+static const char * size_distribution = 0;
 static int processes_count = DEFAULT_PROCESSES_COUNT;
+static int compress_percent = 0;
+static int dedupe_percent = 0;
+static int flag_empty = 0;
+static int flag_metadata = 0;
+static int flag_noatime = 0;
+static int uring_files = 0;
+static struct filebomb_job tree_template; // tree options only
 static int flag_no_clear = 0;
 static int flag_help = 0;
+static struct filebomb_job * jobs = 0;
+static struct filebomb_result * results = 0;
+static struct worker * workers = 0;
+static struct worker_report * worker_reports = 0;
+static int failed_workers = 0;
+static struct payload payload;
+static int output_format = OUTPUT_TEXT;
+static struct report report;
+static struct placement placement;
+static const char * cpus_list = 0;
+static int cache_mode = CACHE_COLD;
+static struct kernel_stats kernel_stats; // of last run of workers
 
 static struct option opts [] = {
     {"folder", required_argument, 0, 'f'},
     {"size", required_argument, 0, 's'},
     {"file-size", required_argument, 0, 'b'},
+    {"size-distribution", required_argument, 0, 'Z'},
     {"processes", required_argument, 0, 'p'},
+    {"compress", required_argument, 0, 'z'},
+    {"dedupe", required_argument, 0, 'D'},
+    {"empty", no_argument, 0, 'e'},
+    {"metadata", no_argument, 0, 'm'},
+    {"noatime", no_argument, 0, 'N'},
+    {"output-format", required_argument, 0, 'o'},
     {"no-clear", no_argument, 0, 'c'},
+    {"cache", required_argument, 0, 'k'},
+    {"uring", required_argument, 0, 'u'},
+    FILEBOMB_TREE_LONG_OPTIONS,
+    PLACEMENT_LONG_OPTIONS,
     {"help", no_argument, 0, 'h'},
     {0, 0, 0, 0}
 };
@@ -52,9 +83,11 @@ long interpret_string_as_bytes_size(char * s) {
 }
 
 int read_args(int argc, char * argv []) {
+    filebomb_job_init(&tree_template);
+    placement_init(&placement);
     int opt_c;
     int opt_i;
-    while ((opt_c = getopt_long(argc, argv, "f:s:b:p:h", opts, &opt_i)) != -1)
+    while ((opt_c = getopt_long(argc, argv, "f:s:b:Z:p:z:D:emNu:" FILEBOMB_TREE_SHORT_OPTIONS PLACEMENT_SHORT_OPTIONS "o:ck:h", opts, &opt_i)) != -1)
     {
         switch (opt_c)
         {
@@ -71,128 +104,238 @@ int read_args(int argc, char * argv []) {
         case 'b':
             file_size = atol(optarg);
             break;
+        case 'Z':
+            if (parse_file_sizes(optarg, &file_sizes)) {
+                fprintf(stderr, "Size distribution was not set properly. See help\n");
+                return 1;
+            }
+            flag_sizes = 1;
+            size_distribution = optarg;
+            break;
         case 'p':
             processes_count = atoi(optarg);
             break;
+        case 'z':
+            compress_percent = atoi(optarg);
+            break;
+        case 'D':
+            dedupe_percent = atoi(optarg);
+            break;
+        case 'e':
+            flag_empty = 1;
+            break;
+        case 'm':
+            flag_metadata = 1;
+            break;
+        case 'N':
+            flag_noatime = 1;
+            break;
+        case 'u':
+            uring_files = atoi(optarg);
+            break;
+        case 'o':
+            output_format = parse_output_format(optarg);
+            break;
         case 'c':
             flag_no_clear = 1;
             break;
+        case 'k':
+            cache_mode = parse_cache_mode(optarg);
+            break;
         case 'h':
             flag_help = 1;
             break;
         default:
+            if (placement_parse_option(&placement, opt_c, optarg)) {
+                if (opt_c == 'C') {
+                    cpus_list = optarg;
+                }
+                break;
+            }
+            filebomb_job_parse_tree_option(&tree_template, opt_c, optarg);
             break;
         }
     }
     return 0;
 }
 
-char** str_split(char* a_str, const char a_delim) {
-    char** result    = 0;
-    size_t count     = 0;
-    char* tmp        = a_str;
-    char* last_comma = 0;
-    char delim[2];
-    delim[0] = a_delim;
-    delim[1] = 0;
-
-    /* Count how many elements will be extracted. */
-    while (*tmp)
-    {
-        if (a_delim == *tmp)
-        {
-            count++;
-            last_comma = tmp;
-        }
-        tmp++;
+int prepare_jobs() {
+    jobs = malloc(processes_count * sizeof(struct filebomb_job));
+    results = malloc(processes_count * sizeof(struct filebomb_result));
+    workers = malloc(processes_count * sizeof(struct worker));
+    worker_reports = malloc(processes_count * sizeof(struct worker_report));
+    if (!jobs || !results || !workers || !worker_reports) {
+        fprintf(stderr, "Can't allocate memory for %d workers\n", processes_count);
+        return 1;
+    }
+    uint64_t seed = random_seed();
+    // all writers copy from one generated pool
+    if (payload_init(&payload, compress_percent, dedupe_percent, seed)) {
+        fprintf(stderr, "Can't allocate payload\n");
+        return 1;
+    }
+    // writers pick sizes up to the largest one; count of files comes from mean size
+    double mean_size = file_size;
+    if (flag_sizes) {
+        file_size = file_sizes.max;
+        mean_size = file_sizes_mean(&file_sizes) > 1 ? file_sizes_mean(&file_sizes) : 1;
+    }
+    for (int i = 0; i < processes_count; ++i) {
+        filebomb_job_init(&jobs[i]);
+        char * worker_folder = malloc(strlen(folder_path) + 16);
+        sprintf(worker_folder, "%s/%d", folder_path, i);
+        jobs[i].folder_path = worker_folder;
+        jobs[i].file_size = file_size;
+        jobs[i].sizes = flag_sizes ? &file_sizes : 0;
+        jobs[i].files_count = (long) (total_size / processes_count / mean_size);
+        jobs[i].payload = &payload;
+        jobs[i].flag_empty = flag_empty;
+        jobs[i].flag_noatime = flag_noatime;
+        jobs[i].uring_files = uring_files;
+        jobs[i].depth = tree_template.depth;
+        jobs[i].fanout = tree_template.fanout;
+        jobs[i].files_per_dir = tree_template.files_per_dir;
+        jobs[i].seed = seed + i;
+        workers[i].placement = &placement;
     }
+    return 0;
+}
 
-    /* Add space for trailing token. */
-    count += last_comma < (a_str + strlen(a_str) - 1);
+int run_writer(struct worker * worker) {
+    return filebomb_job_write(&jobs[worker->id], worker, &results[worker->id]);
+}
 
-    /* Add space for terminating null string so caller
-       knows where the list of returned strings ends. */
-    count++;
+int run_reader(struct worker * worker) {
+    return filebomb_job_read(&jobs[worker->id], worker, &results[worker->id]);
+}
 
-    result = malloc(sizeof(char*) * count);
+int run_mkdir(struct worker * worker) {
+    return filebomb_job_mkdir(&jobs[worker->id], worker, &results[worker->id]);
+}
 
-    if (result)
-    {
-        size_t idx  = 0;
-        char* token = strtok(a_str, delim);
+int run_stat(struct worker * worker) {
+    return filebomb_job_metadata(&jobs[worker->id], FILEBOMB_STAT, worker, &results[worker->id]);
+}
 
-        while (token)
-        {
-            assert(idx < count);
-            *(result + idx++) = strdup(token);
-            token = strtok(0, delim);
-        }
-        assert(idx == count - 1);
-        *(result + idx) = 0;
-    }
+int run_open(struct worker * worker) {
+    return filebomb_job_metadata(&jobs[worker->id], FILEBOMB_OPEN, worker, &results[worker->id]);
+}
 
-    return result;
+int run_rename(struct worker * worker) {
+    return filebomb_job_metadata(&jobs[worker->id], FILEBOMB_RENAME, worker, &results[worker->id]);
 }
 
-void print_args(char * const * args) {
-    int i = 0;
-    printf("args: ");
-    while (args[i] != 0)
-    {
-        printf("%s ", args[i]);
-        ++i;
-    }
-    printf("\n");
+int run_move(struct worker * worker) {
+    return filebomb_job_metadata(&jobs[worker->id], FILEBOMB_MOVE, worker, &results[worker->id]);
 }
 
-int fork_and_exec(const char * path, char * const * args) {
-    //print_args(args);
-    pid_t pid = fork();
-    if (pid < 0) {
-        return 1;
-    } else if (pid == 0) { // child
-        char * env [] = {NULL};
-        if(execve(path, args, env) == -1) {
-            fprintf(stderr, "Execution of %s failed\n", path);
-            exit(2);
-        }
-    }
-    return 0;
+int run_unlink(struct worker * worker) {
+    return filebomb_job_metadata(&jobs[worker->id], FILEBOMB_UNLINK, worker, &results[worker->id]);
 }
 
-int launch_writer(int id) {
-    char args_string [512];
-    long files_count = total_size / processes_count / file_size;
-    sprintf(args_string, WRITER_PATH " --folder %s/%d --file-size %ld --count %ld", folder_path, id, file_size, files_count);
-    char ** args = str_split(args_string, ' ');
-    return fork_and_exec(WRITER_PATH, args);
+double launch_tests(int (* func) (struct worker *), struct filebomb_result * total) {
+    kernel_stats_init(&kernel_stats, folder_path);
+    kernel_stats_begin(&kernel_stats);
+    double time = run_workers(workers, processes_count, func, 0);
+    // merge results of all workers
+    filebomb_result_init(total);
+    for (int i = 0; i < processes_count; ++i) {
+        if (workers[i].status) {
+            fprintf(stderr, "Test %d failed with code %d\n", i, workers[i].status);
+            ++failed_workers;
+            continue;
+        }
+        filebomb_result_merge(total, &results[i]);
+    }
+    return time;
 }
 
-int launch_reader(int id) {
-    char args_string [512];
-    sprintf(args_string, READER_PATH " --folder %s/%d", folder_path, id);
-    char ** args = str_split(args_string, ' ');
-    return fork_and_exec(READER_PATH, args);
+// counters of last run till now, so create phase includes its sync
+void summarize_kernel(uint64_t logical_read, uint64_t logical_written, struct kernel_summary * summary) {
+    kernel_stats_end(&kernel_stats);
+    kernel_stats_summarize(&kernel_stats, logical_read, logical_written, summary);
 }
 
-double launch_tests(int (* launch_func) (int)) {
-    struct timespec start_time;
-    timespec_get(&start_time, TIME_UTC);
-    // launch
+// passes last phase to machine-readable report
+void add_phase(const char * name, double time, const struct filebomb_result * total, const struct kernel_summary * kernel) {
+    struct size_report sizes [SIZE_BUCKETS];
+    struct phase_report phase = {name, time, 0, total->latency.count, 0, &total->latency, processes_count, worker_reports, 0, sizes, kernel};
+    for (int i = 0; i < SIZE_BUCKETS; ++i) {
+        if (total->size_files[i]) {
+            struct size_report r = {size_bucket_min(i), i ? size_bucket_min(i + 1) : 1, total->size_files[i], total->size_bytes[i], total->size_latency[i]};
+            sizes[phase.sizes_count++] = r;
+        }
+    }
     for (int i = 0; i < processes_count; ++i) {
-        if (launch_func(i)) {
-            fprintf(stderr, "Launch of test %d failed\n", i);
+        struct worker_report * w = &worker_reports[i];
+        w->id = i;
+        w->status = workers[i].status;
+        w->elapsed = workers[i].elapsed;
+        w->bytes = results[i].bytes;
+        w->ops = results[i].latency.count;
+        w->errors = results[i].errors + (workers[i].status ? 1 : 0);
+        w->user_time = workers[i].user_time;
+        w->sys_time = workers[i].sys_time;
+        w->latency = &results[i].latency;
+        if (!workers[i].status) {
+            phase.bytes += w->bytes;
         }
+        phase.errors += w->errors;
     }
-    // wait for writers to finish
-    int writer_status;
+    report_phase(&report, &phase);
+}
+
+void add_config(int argc, char * argv []) {
+    char command [4096] = "";
+    size_t length = 0;
+    for (int i = 0; i < argc && length < sizeof(command); ++i) {
+        length += snprintf(command + length, sizeof(command) - length, i ? " %s" : "%s", argv[i]);
+    }
+    report_config_string(&report, "command", command);
+    report_config_string(&report, "folder", folder_path);
+    report_config_integer(&report, "size", total_size);
+    report_config_integer(&report, "file_size", file_size);
+    report_config_string(&report, "size_distribution", size_distribution);
+    report_config_number(&report, "processes", processes_count);
+    report_config_string(&report, "cpus", cpus_list);
+    report_config_number(&report, "numa_node", placement.numa_node);
+    report_config_string(&report, "cache", cache_mode_name(cache_mode));
+    report_config_number(&report, "compress", compress_percent);
+    report_config_number(&report, "dedupe", dedupe_percent);
+    report_config_number(&report, "empty", flag_empty);
+    report_config_number(&report, "metadata", flag_metadata);
+    report_config_number(&report, "noatime", flag_noatime);
+    report_config_number(&report, "uring_files", uring_files);
+    report_config_number(&report, "depth", tree_template.depth);
+    report_config_number(&report, "fanout", tree_template.fanout);
+    report_config_integer(&report, "files_per_dir", tree_template.files_per_dir);
+}
+
+// prints CPU time of last phase summed over workers
+void print_cpu(uint64_t bytes, uint64_t ops) {
+    double user_time = 0;
+    double sys_time = 0;
     for (int i = 0; i < processes_count; ++i) {
-        wait(&writer_status);
+        user_time += workers[i].user_time;
+        sys_time += workers[i].sys_time;
     }
-    // return delta
-    struct timespec end_time;
-    timespec_get(&end_time, TIME_UTC);
-    return (end_time.tv_sec-start_time.tv_sec) + 1e-9 * (end_time.tv_nsec-start_time.tv_nsec);
+    double cpu = user_time + sys_time;
+    printf("CPU: user %.3f s, sys %.3f s, %.3f s per GiB, %.3f s per million ops\n",
+        user_time, sys_time, cpu_per_gib(cpu, bytes), cpu_per_m_ops(cpu, ops));
+}
+
+// runs metadata phase and reports its rate
+void run_metadata_phase(const char * name, const char * title, int (* func) (struct worker *), struct filebomb_result * total) {
+    double time = launch_tests(func, total);
+    struct kernel_summary kernel;
+    summarize_kernel(0, 0, &kernel);
+    if (output_format == OUTPUT_TEXT) {
+        printf("%s in %f s, %.0f ops/s\n", title, time, total->latency.count / time);
+        histogram_print(title, &total->latency);
+        print_cpu(total->bytes, total->latency.count);
+        kernel_summary_print(&kernel);
+    }
+    add_phase(name, time, total, &kernel);
 }
 
 double do_sync() {
@@ -222,11 +365,21 @@ int clear() {
     return 0;
 }
 
-int drop_cache_if_root() {
-    if (getuid() == 0) { // if root
-        system("echo 1 > /proc/sys/vm/drop_caches");
+// brings files of all workers into cache mode before reading
+void prepare_cache() {
+    struct cache_state state;
+    cache_state_init(&state, cache_mode);
+    char path [512];
+    for (int i = 0; i < processes_count; ++i) {
+        sprintf(path, "%s/%d", folder_path, i);
+        if (cache_prepare_folder(&state, path)) {
+            fprintf(stderr, "Can't walk folder %s\n", path);
+        }
+    }
+    cache_state_check(&state);
+    if (output_format == OUTPUT_TEXT) {
+        cache_state_print(&state);
     }
-    return 0;
 }
 
 void print_help() {
@@ -235,7 +388,18 @@ void print_help() {
     printf("--folder PATH | -f PATH sets folder to create files (required argument)\n");
     printf("--size SIZE | -s SIZE sets total size to write and read in bytes. You can use K (kibibytes), M (mebibytes) and G (gibibytes) ending (required argument)\n");
     printf("--file-size SIZE | -b SIZE sets file size to write and read each time. Default value is %d\n", DEFAULT_FILE_SIZE);
-    printf("--processes COUNT | -p COUNT sets count of parallel processes\n");
+    printf("--size-distribution DIST | -Z DIST picks size of every file from DIST instead of file size: uniform:MIN-MAX, lognormal:MU/SIGMA (of natural log of size in bytes; capped at exp(MU + %d SIGMA)) or histogram:PATH (lines of SIZE WEIGHT with sizes ascending; files of line get sizes above previous SIZE up to SIZE). Count of files is size divided by mean file size. Results are broken down by power of two size ranges\n", LOGNORMAL_CAP_SIGMAS);
+    printf("--processes COUNT | -p COUNT sets count of parallel workers. Workers are threads started together\n");
+    printf("--compress PERCENT | -z PERCENT makes written data compressible: PERCENT of bytes are zeros. Default value is 0\n");
+    printf("--dedupe PERCENT | -D PERCENT makes PERCENT of written 4 KiB chunks duplicates of each other. Default value is 0\n");
+    printf("--empty | -e creates empty files; size and file size still set count of files\n");
+    printf("--metadata | -m after reading runs metadata phases on all files: stat, open-close, rename within folder, rename into another folder and unlink\n");
+    printf("--noatime | -N makes readers open files with O_NOATIME (owner or root only; otherwise ignored)\n");
+    printf("--uring FILES | -u FILES makes every worker keep FILES files in flight with io_uring (linked open, read or write and close). Default is blocking calls\n");
+    filebomb_tree_print_help();
+    placement_print_help();
+    cache_print_help();
+    printf("--output-format FORMAT | -o FORMAT sets format of results: text (default), json or csv. JSON and CSV include config and per-worker results\n");
     printf("--no-clear prevents benchmark from clearing temp files\n");
     printf("--help | -h shows this tip\n");
 }
@@ -265,27 +429,87 @@ int main(int argc, char * argv []) {
         fprintf(stderr, "File size was not set properly. See help\n");
         return 2;
     }
+    if (compress_percent < 0 || compress_percent > 100 || dedupe_percent < 0 || dedupe_percent > 100) {
+        fprintf(stderr, "Compressibility and dedupe ratio must be percents. See help\n");
+        return 2;
+    }
+    if (uring_files < 0 || uring_files > MAX_URING_FILES) {
+        fprintf(stderr, "Count of files in flight was not set properly. See help\n");
+        return 2;
+    }
+    if (filebomb_job_check_tree(&tree_template)) {
+        return 2;
+    }
+    if (placement_check(&placement)) {
+        return 2;
+    }
+    if (cache_mode < 0) {
+        fprintf(stderr, "Cache mode was not set properly. See help\n");
+        return 2;
+    }
+    if (output_format < 0) {
+        fprintf(stderr, "Output format was not set properly. See help\n");
+        return 2;
+    }
+    if (prepare_jobs()) {
+        return 2;
+    }
+    report_begin(&report, output_format, "filebomb-benchmark");
+    add_config(argc, argv);
     // prepare folders
     if(make_dirs()) {
         return 3; // error already printed
     }
+    struct filebomb_result * total = malloc(sizeof(struct filebomb_result));
+    // make folder trees in parallel
+    if (tree_template.depth > 0) {
+        run_metadata_phase("mkdir", "Mkdir", &run_mkdir, total);
+    }
     // do writing tests
-    double writing_time = launch_tests(&launch_writer);
+    double writing_time = launch_tests(&run_writer, total);
     // sync
     writing_time += do_sync();
+    struct kernel_summary kernel;
+    summarize_kernel(0, total->bytes, &kernel);
     // report
-    printf("Written in %f s\n", writing_time);
-    // flush disk cache (root only)
-    drop_cache_if_root();
+    if (output_format == OUTPUT_TEXT) {
+        printf("Written in %f s\n", writing_time);
+        histogram_print("Create", &total->latency);
+        filebomb_result_print_sizes("Create", total);
+        print_cpu(total->bytes, total->latency.count);
+        kernel_summary_print(&kernel);
+    }
+    add_phase("create", writing_time, total, &kernel);
+    prepare_cache();
     // do reading tests
-    double reading_time = launch_tests(&launch_reader);
+    double reading_time = launch_tests(&run_reader, total);
+    summarize_kernel(total->bytes, 0, &kernel);
     // report
-    printf("Read in %f s\n", reading_time);
+    if (output_format == OUTPUT_TEXT) {
+        printf("Read in %f s\n", reading_time);
+        histogram_print("Read", &total->latency);
+        filebomb_result_print_sizes("Read", total);
+        print_cpu(total->bytes, total->latency.count);
+        kernel_summary_print(&kernel);
+    }
+    add_phase("read", reading_time, total, &kernel);
+    if (flag_metadata) {
+        run_metadata_phase("stat", "Stat", &run_stat, total);
+        run_metadata_phase("open", "Open", &run_open, total);
+        run_metadata_phase("rename", "Rename", &run_rename, total);
+        run_metadata_phase("move", "Move", &run_move, total);
+        run_metadata_phase("unlink", "Unlink", &run_unlink, total);
+    }
+    report_end(&report);
+    free(total);
     // clear
     if (!flag_no_clear) {
         if (clear()) {
             return 4; // error already printed
         }
     }
+    if (failed_workers) {
+        return 5;
+    }
     return 0;
 }
@@ -0,0 +1,736 @@
+#ifndef IO_BENCHMARK_FILEBOMB_WORKER_H
+#define IO_BENCHMARK_FILEBOMB_WORKER_H
+
+// Small files writer and reader shared by filebomb-benchmark and its
+// standalone worker utilities. Requires _GNU_SOURCE to be defined before
+// the first include.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "uring.h"
+#include "histogram.h"
+#include "payload.h"
+#include "file-sizes.h"
+#include "worker-pool.h"
+
+#define DEFAULT_FILE_SIZE 512
+#define READ_BLOCK_SIZE 512
+#define DIRENTS_BUFFER_SIZE (256 * 1024)
+
+// metadata phases; they go in this order over files made by writer
+#define FILEBOMB_STAT 0
+#define FILEBOMB_OPEN 1
+#define FILEBOMB_RENAME 2 // within folder
+#define FILEBOMB_MOVE 3 // into another folder
+#define FILEBOMB_UNLINK 4
+
+#define MOVED_FOLDER_NAME "moved"
+
+#define MAX_URING_FILES 4096
+
+#define MAX_TREE_DEPTH 8
+#define MAX_TREE_LEAVES (1L << 24)
+#define DEFAULT_FANOUT 256
+#define MAX_NAME_LENGTH 256 // file name relative to worker folder
+
+#define FILEBOMB_TREE_SHORT_OPTIONS "d:F:n:"
+#define FILEBOMB_TREE_LONG_OPTIONS \
+    {"depth", required_argument, 0, 'd'}, \
+    {"fanout", required_argument, 0, 'F'}, \
+    {"files-per-dir", required_argument, 0, 'n'}
+
+struct filebomb_job {
+    const char * folder_path;
+    const char * source_path; // NULL means generated payload
+    const struct payload * payload; // shared generated payload; NULL makes job generate own one
+    int file_size; // size of every file, or largest one when sizes are set
+    const struct file_sizes * sizes; // NULL means every file has file size bytes
+    long files_count; // writer only; reader reads every file in folder
+    int compress_percent;
+    int dedupe_percent;
+    int flag_empty; // create files without data
+    int flag_noatime; // reader opens files with O_NOATIME
+    int uring_files; // files in flight per worker with io_uring; 0 means blocking calls
+    int depth; // levels of folders under worker folder; 0 means flat
+    int fanout; // subfolders of every folder in tree
+    long files_per_dir; // files in leaf folder before next one is used; 0 spreads files evenly
+    uint64_t seed;
+};
+
+struct filebomb_result {
+    struct histogram latency;
+    uint64_t bytes;
+    uint64_t errors; // files skipped
+    // per power of two size bucket; filled by create and read
+    uint64_t size_files [SIZE_BUCKETS];
+    uint64_t size_bytes [SIZE_BUCKETS];
+    uint64_t size_latency [SIZE_BUCKETS]; // ns spent on files of bucket
+};
+
+static inline void filebomb_job_init(struct filebomb_job * job) {
+    memset(job, 0, sizeof(*job));
+    job->file_size = DEFAULT_FILE_SIZE;
+    job->fanout = DEFAULT_FANOUT;
+}
+
+// returns 1 if option is a tree option
+static inline int filebomb_job_parse_tree_option(struct filebomb_job * job, int opt_c, char * arg) {
+    switch (opt_c)
+    {
+    case 'd':
+        job->depth = atoi(arg);
+        break;
+    case 'F':
+        job->fanout = atoi(arg);
+        break;
+    case 'n':
+        job->files_per_dir = atol(arg);
+        break;
+    default:
+        return 0;
+    }
+    return 1;
+}
+
+// count of folders at level of tree; level 0 is worker folder
+static inline long filebomb_tree_width(const struct filebomb_job * job, int level) {
+    long width = 1;
+    for (int i = 0; i < level; ++i) {
+        width *= job->fanout;
+    }
+    return width;
+}
+
+// returns 0 if tree options are valid, otherwise prints error
+static inline int filebomb_job_check_tree(const struct filebomb_job * job) {
+    if (job->depth < 0 || job->depth > MAX_TREE_DEPTH || job->fanout <= 0 || job->files_per_dir < 0) {
+        fprintf(stderr, "Tree shape was not set properly. See help\n");
+        return 1;
+    }
+    long leaves = 1;
+    for (int i = 0; i < job->depth; ++i) {
+        leaves *= job->fanout;
+        if (leaves > MAX_TREE_LEAVES) {
+            fprintf(stderr, "Tree has more than %ld leaf folders. See help\n", MAX_TREE_LEAVES);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static inline void filebomb_tree_print_help() {
+    printf("--depth LEVELS | -d LEVELS puts files into a tree of folders LEVELS deep under every worker folder. Default value is 0 (flat folder)\n");
+    printf("--fanout COUNT | -F COUNT sets count of subfolders of every folder in tree. Default value is %d\n", DEFAULT_FANOUT);
+    printf("--files-per-dir COUNT | -n COUNT fills leaf folders one by one with COUNT files (wrapping around when leaves are over). By default files are spread evenly\n");
+}
+
+// writes path of folder number index at level relative to worker folder with trailing slash;
+// empty for worker folder itself
+static inline void filebomb_folder_name(const struct filebomb_job * job, int level, long index, char * name) {
+    name[0] = 0;
+    int length = 0;
+    for (int i = level - 1; i >= 0; --i) {
+        long width = filebomb_tree_width(job, i);
+        length += sprintf(name + length, "%lx/", index / width % job->fanout);
+    }
+}
+
+// writes path of file number i with suffix relative to worker folder
+static inline void filebomb_file_name(const struct filebomb_job * job, long i, const char * suffix, char * name) {
+    long leaves = filebomb_tree_width(job, job->depth);
+    long leaf = job->files_per_dir ? i / job->files_per_dir % leaves : i % leaves;
+    filebomb_folder_name(job, job->depth, leaf, name);
+    sprintf(name + strlen(name), "%ld.%s", i, suffix);
+}
+
+static inline void filebomb_result_init(struct filebomb_result * result) {
+    histogram_init(&result->latency);
+    result->bytes = 0;
+    result->errors = 0;
+    memset(result->size_files, 0, sizeof(result->size_files));
+    memset(result->size_bytes, 0, sizeof(result->size_bytes));
+    memset(result->size_latency, 0, sizeof(result->size_latency));
+}
+
+// records file written or read whole
+static inline void filebomb_result_record(struct filebomb_result * result, uint64_t latency, uint64_t bytes) {
+    histogram_record(&result->latency, latency);
+    result->bytes += bytes;
+    int bucket = size_bucket(bytes);
+    result->size_files[bucket]++;
+    result->size_bytes[bucket] += bytes;
+    result->size_latency[bucket] += latency;
+}
+
+static inline void filebomb_result_merge(struct filebomb_result * dst, const struct filebomb_result * src) {
+    histogram_merge(&dst->latency, &src->latency);
+    dst->bytes += src->bytes;
+    dst->errors += src->errors;
+    for (int i = 0; i < SIZE_BUCKETS; ++i) {
+        dst->size_files[i] += src->size_files[i];
+        dst->size_bytes[i] += src->size_bytes[i];
+        dst->size_latency[i] += src->size_latency[i];
+    }
+}
+
+// prints files, mean latency and throughput while busy with them per size bucket;
+// nothing when all files fall into one bucket
+static inline void filebomb_result_print_sizes(const char * name, const struct filebomb_result * result) {
+    int used = 0;
+    for (int i = 0; i < SIZE_BUCKETS; ++i) {
+        used += result->size_files[i] > 0;
+    }
+    if (used < 2) {
+        return;
+    }
+    for (int i = 0; i < SIZE_BUCKETS; ++i) {
+        if (!result->size_files[i]) {
+            continue;
+        }
+        // bucket covers sizes from low up to high, not including high
+        char low [32] = "empty";
+        char high [32] = "";
+        if (i) {
+            format_file_size(size_bucket_min(i), low);
+            strcat(low, "..");
+            format_file_size(size_bucket_min(i + 1), high);
+        }
+        double busy = result->size_latency[i] / 1e9;
+        printf("%s %s%s: %llu files, mean %.1f us, %.1f MiB/s\n", name, low, high,
+            (unsigned long long) result->size_files[i],
+            result->size_latency[i] / 1e3 / result->size_files[i],
+            busy > 0 ? result->size_bytes[i] / busy / (1024 * 1024) : 0);
+    }
+}
+
+// state of one running writer
+struct filebomb_writer {
+    const struct filebomb_job * job;
+    int source_fd; // -1 means generated payload
+    struct payload_stream * stream;
+    long next_index;
+    struct rng rng; // picks file sizes
+};
+
+// picks size and prepares data of next file; returns 0 or error code
+static inline int filebomb_writer_fill(struct filebomb_writer * writer, char * buf, size_t * length) {
+    const struct filebomb_job * job = writer->job;
+    if (job->flag_empty) {
+        *length = 0;
+        return 0;
+    }
+    *length = job->sizes ? (size_t) file_sizes_next(job->sizes, &writer->rng) : (size_t) job->file_size;
+    if (writer->source_fd == -1) {
+        payload_fill(writer->stream, buf, *length);
+    } else if (read(writer->source_fd, buf, *length) != (ssize_t) *length) {
+        fprintf(stderr, "Error while reading source %s\n", job->source_path);
+        return 11;
+    }
+    return 0;
+}
+
+static inline int filebomb_write_sync(struct filebomb_writer * writer, struct worker * worker, struct filebomb_result * result) {
+    const struct filebomb_job * job = writer->job;
+    char * buf = malloc(job->file_size);
+    char name [MAX_NAME_LENGTH];
+    char file_path [512 + MAX_NAME_LENGTH];
+    int status = 0;
+    worker_start(worker);
+    for (long i = 0; i < job->files_count; ++i) {
+        filebomb_file_name(job, i, "bin", name);
+        sprintf(file_path, "%s/%s", job->folder_path, name);
+        size_t length;
+        if ((status = filebomb_writer_fill(writer, buf, &length))) {
+            break;
+        }
+        // creation latency covers open, write and close
+        uint64_t start = clock_ns();
+        int fd = open(file_path, O_WRONLY | O_CREAT, 0644);
+        if (fd == -1) {
+            fprintf(stderr, "Can't open file %s\n", file_path);
+            status = 4;
+            break;
+        }
+        if (length && write(fd, buf, length) != (ssize_t) length) {
+            fprintf(stderr, "Error while writing file %s\n", file_path);
+            close(fd);
+            status = 6;
+            break;
+        }
+        close(fd);
+        filebomb_result_record(result, clock_ns() - start, length);
+    }
+    free(buf);
+    return status;
+}
+
+// gives name and data of next file to io_uring pipeline; returns 0, -1 when files are over, or error code
+static inline int filebomb_writer_next(void * ctx, char * name, char * buf, size_t * length) {
+    struct filebomb_writer * writer = ctx;
+    if (writer->next_index >= writer->job->files_count) {
+        return -1;
+    }
+    filebomb_file_name(writer->job, writer->next_index++, "bin", name);
+    return filebomb_writer_fill(writer, buf, length);
+}
+
+// file in flight of io_uring pipeline
+struct filebomb_slot {
+    char name [MAX_NAME_LENGTH];
+    uint64_t start;
+    int pending; // completions left in chain
+    int failed;
+    size_t length; // bytes to write, or buffer size for reads
+    int64_t bytes;
+};
+
+// keeps uring_files files in flight, each as hard linked OPENAT, READ or WRITE and CLOSE
+// on a direct descriptor, so a file needs no round trip to user space between steps;
+// next gives names relative to job folder and data with its length to write; reads take up to file size bytes
+static inline int filebomb_uring(const struct filebomb_job * job, int op, int (* next) (void *, char *, char *, size_t *), void * ctx, struct worker * worker, struct filebomb_result * result) {
+    int files = job->uring_files;
+    int dir_fd = open(job->folder_path, O_RDONLY | O_DIRECTORY);
+    if (dir_fd == -1) {
+        fprintf(stderr, "Can't open folder %s\n", job->folder_path);
+        return 3;
+    }
+    struct uring ring;
+    if (uring_init(&ring, 3 * files, 0)) {
+        fprintf(stderr, "Can't set up io_uring: %s\n", strerror(errno));
+        close(dir_fd);
+        return 12;
+    }
+    // sparse table of direct descriptors, one per slot
+    int * fds = malloc(files * sizeof(int));
+    int * free_slots = malloc(files * sizeof(int));
+    for (int i = 0; i < files; ++i) {
+        fds[i] = -1;
+        free_slots[i] = i;
+    }
+    int registered = uring_register_files(&ring, fds, files);
+    free(fds);
+    if (registered) {
+        fprintf(stderr, "Can't register files: %s\n", strerror(errno));
+        free(free_slots);
+        uring_exit(&ring);
+        close(dir_fd);
+        return 12;
+    }
+    int free_count = files;
+    size_t buf_size = job->file_size;
+    char * bufs = malloc(files * buf_size);
+    struct filebomb_slot * slots = malloc(files * sizeof(struct filebomb_slot));
+    int open_flags = op == IORING_OP_WRITE ? O_WRONLY | O_CREAT : O_RDONLY | (job->flag_noatime ? O_NOATIME : 0);
+    int in_flight = 0;
+    int files_over = 0;
+    int status = 0;
+    worker_start(worker);
+    while (!status) {
+        while (free_count > 0 && !files_over) {
+            int slot = free_slots[free_count - 1];
+            struct filebomb_slot * s = &slots[slot];
+            char * buf = bufs + slot * buf_size;
+            s->length = buf_size;
+            int ret = next(ctx, s->name, buf, &s->length);
+            if (ret == -1) {
+                files_over = 1;
+                break;
+            }
+            if (ret) {
+                status = ret;
+                break;
+            }
+            --free_count;
+            // empty files need no write
+            int with_data = op == IORING_OP_READ || s->length > 0;
+            // hard links keep chain going after short read, so close always runs
+            struct io_uring_sqe * sqe = uring_get_sqe(&ring);
+            uring_prep_rw(sqe, IORING_OP_OPENAT, dir_fd, s->name, 0644, 0);
+            sqe->open_flags = open_flags;
+            sqe->file_index = slot + 1;
+            sqe->flags = IOSQE_IO_HARDLINK;
+            sqe->user_data = slot * 4;
+            if (with_data) {
+                sqe = uring_get_sqe(&ring);
+                uring_prep_rw(sqe, op, slot, buf, s->length, 0);
+                sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+                sqe->user_data = slot * 4 + 1;
+            }
+            sqe = uring_get_sqe(&ring);
+            uring_prep_rw(sqe, IORING_OP_CLOSE, 0, 0, 0, 0);
+            sqe->file_index = slot + 1;
+            sqe->user_data = slot * 4 + 2;
+            s->pending = with_data ? 3 : 2;
+            s->failed = 0;
+            s->bytes = 0;
+            s->start = clock_ns();
+            ++in_flight;
+        }
+        if (!in_flight) {
+            break;
+        }
+        if (uring_submit_and_wait(&ring, 1) < 0) {
+            fprintf(stderr, "Error while submitting to io_uring: %s\n", strerror(errno));
+            status = 12;
+            break;
+        }
+        struct io_uring_cqe * cqe;
+        while ((cqe = uring_peek_cqe(&ring))) {
+            int slot = (int) (cqe->user_data / 4);
+            int stage = (int) (cqe->user_data % 4);
+            struct filebomb_slot * s = &slots[slot];
+            if (cqe->res < 0) {
+                // steps after failed open fail too; report the first one only
+                if (!s->failed) {
+                    static const char * stages [] = {"open", "access", "close"};
+                    fprintf(stderr, "Can't %s file %s/%s: %s\n", stages[stage], job->folder_path, s->name, strerror(-cqe->res));
+                }
+                s->failed = 1;
+            } else if (stage == 1) {
+                s->bytes = cqe->res;
+                if (op == IORING_OP_WRITE && (size_t) cqe->res != s->length) {
+                    fprintf(stderr, "Error while writing file %s/%s\n", job->folder_path, s->name);
+                    s->failed = 1;
+                }
+            }
+            if (--s->pending == 0) {
+                if (s->failed) {
+                    result->errors++;
+                } else {
+                    filebomb_result_record(result, clock_ns() - s->start, s->bytes);
+                }
+                free_slots[free_count++] = slot;
+                --in_flight;
+            }
+            uring_cqe_seen(&ring);
+        }
+    }
+    // let chains in flight finish before their buffers are released
+    while (in_flight > 0 && uring_submit_and_wait(&ring, 1) >= 0) {
+        struct io_uring_cqe * cqe;
+        while ((cqe = uring_peek_cqe(&ring))) {
+            if (--slots[cqe->user_data / 4].pending == 0) {
+                --in_flight;
+            }
+            uring_cqe_seen(&ring);
+        }
+    }
+    free(slots);
+    free(bufs);
+    free(free_slots);
+    uring_exit(&ring);
+    close(dir_fd);
+    return status;
+}
+
+// worker may be NULL for standalone runs; returns 0 or error code
+static inline int filebomb_job_write(const struct filebomb_job * job, struct worker * worker, struct filebomb_result * result) {
+    filebomb_result_init(result);
+    // open source or prepare generated payload
+    int source_fd = -1;
+    struct payload own_payload;
+    own_payload.pool = 0;
+    struct payload_stream stream;
+    if (job->source_path) {
+        source_fd = open(job->source_path, O_RDONLY);
+        if (source_fd == -1) {
+            fprintf(stderr, "Can't open source %s\n", job->source_path);
+            return 10;
+        }
+    } else {
+        const struct payload * payload = job->payload;
+        if (!payload) {
+            if (payload_init(&own_payload, job->compress_percent, job->dedupe_percent, job->seed)) {
+                fprintf(stderr, "Can't allocate payload\n");
+                return 10;
+            }
+            payload = &own_payload;
+        }
+        payload_stream_init(&stream, payload, job->seed);
+    }
+    struct filebomb_writer writer = {job, source_fd, &stream, 0, {{0}}};
+    rng_seed(&writer.rng, mix64(job->seed));
+    int status;
+    if (job->uring_files) {
+        status = filebomb_uring(job, IORING_OP_WRITE, &filebomb_writer_next, &writer, worker, result);
+    } else {
+        status = filebomb_write_sync(&writer, worker, result);
+    }
+    if (source_fd != -1) {
+        close(source_fd);
+    }
+    if (own_payload.pool) {
+        payload_free(&own_payload);
+    }
+    return status;
+}
+
+// entry returned by getdents64
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name [];
+};
+
+// lists files of leaf folders one by one in large getdents64 batches
+struct filebomb_lister {
+    const struct filebomb_job * job;
+    int root_fd; // worker folder
+    int dir_fd; // current leaf folder
+    long leaf;
+    char prefix [MAX_NAME_LENGTH]; // current leaf folder relative to worker folder
+    char * dirents;
+    long size;
+    long pos;
+};
+
+static inline int filebomb_lister_open(struct filebomb_lister * lister, const struct filebomb_job * job) {
+    lister->root_fd = open(job->folder_path, O_RDONLY | O_DIRECTORY);
+    if (lister->root_fd == -1) {
+        fprintf(stderr, "Can't open folder %s\n", job->folder_path);
+        return 3;
+    }
+    lister->job = job;
+    lister->dir_fd = -1;
+    lister->leaf = -1;
+    lister->dirents = malloc(DIRENTS_BUFFER_SIZE);
+    lister->size = 0;
+    lister->pos = 0;
+    return 0;
+}
+
+static inline void filebomb_lister_close_leaf(struct filebomb_lister * lister) {
+    if (lister->dir_fd != -1 && lister->dir_fd != lister->root_fd) {
+        close(lister->dir_fd);
+    }
+    lister->dir_fd = -1;
+}
+
+static inline void filebomb_lister_close(struct filebomb_lister * lister) {
+    filebomb_lister_close_leaf(lister);
+    free(lister->dirents);
+    close(lister->root_fd);
+}
+
+// returns next entry which is not a folder or NULL when entries are over;
+// entry is in lister->dir_fd folder
+static inline struct linux_dirent64 * filebomb_lister_next(struct filebomb_lister * lister) {
+    const struct filebomb_job * job = lister->job;
+    while (1) {
+        if (lister->pos >= lister->size) {
+            lister->size = 0;
+            lister->pos = 0;
+            if (lister->dir_fd != -1) {
+                lister->size = syscall(SYS_getdents64, lister->dir_fd, lister->dirents, DIRENTS_BUFFER_SIZE);
+            }
+            if (lister->size <= 0) {
+                // go to next leaf
+                filebomb_lister_close_leaf(lister);
+                if (++lister->leaf >= filebomb_tree_width(job, job->depth)) {
+                    return 0;
+                }
+                filebomb_folder_name(job, job->depth, lister->leaf, lister->prefix);
+                lister->dir_fd = job->depth ? openat(lister->root_fd, lister->prefix, O_RDONLY | O_DIRECTORY) : lister->root_fd;
+                if (lister->dir_fd == -1) {
+                    fprintf(stderr, "Can't open folder %s/%s\n", job->folder_path, lister->prefix);
+                }
+                continue;
+            }
+        }
+        struct linux_dirent64 * entry = (struct linux_dirent64 *) (lister->dirents + lister->pos);
+        lister->pos += entry->d_reclen;
+        if (entry->d_type != DT_DIR && strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
+            return entry;
+        }
+    }
+}
+
+// gives name of next file to io_uring pipeline
+static inline int filebomb_lister_next_name(void * ctx, char * name, char * buf, size_t * length) {
+    (void) buf;
+    (void) length;
+    struct filebomb_lister * lister = ctx;
+    struct linux_dirent64 * entry = filebomb_lister_next(lister);
+    if (!entry) {
+        return -1;
+    }
+    snprintf(name, MAX_NAME_LENGTH, "%s%s", lister->prefix, entry->d_name);
+    return 0;
+}
+
+static inline int filebomb_read_sync(const struct filebomb_job * job, struct filebomb_lister * lister, struct worker * worker, struct filebomb_result * result) {
+    // files are opened relative to their folder, so paths are never formatted or resolved again
+    size_t buf_size = job->file_size > 0 ? job->file_size : READ_BLOCK_SIZE;
+    char * buf = malloc(buf_size);
+    int open_flags = O_RDONLY | (job->flag_noatime ? O_NOATIME : 0);
+    int status = 0;
+    worker_start(worker);
+    struct linux_dirent64 * entry;
+    while ((entry = filebomb_lister_next(lister))) {
+        // read latency covers open, size lookup, read and close
+        uint64_t start = clock_ns();
+        int fd = openat(lister->dir_fd, entry->d_name, open_flags);
+        if (fd == -1 && errno == EPERM && (open_flags & O_NOATIME)) {
+            // O_NOATIME is allowed to file owner only
+            open_flags &= ~O_NOATIME;
+            fd = openat(lister->dir_fd, entry->d_name, open_flags);
+        }
+        if (fd == -1) {
+            fprintf(stderr, "Can't open file %s/%s%s\n", job->folder_path, lister->prefix, entry->d_name);
+            result->errors++;
+            continue;
+        }
+        struct statx stx;
+        if (statx(fd, "", AT_EMPTY_PATH, STATX_SIZE, &stx)) {
+            fprintf(stderr, "Can't get size of file %s/%s%s\n", job->folder_path, lister->prefix, entry->d_name);
+            close(fd);
+            status = 5;
+            break;
+        }
+        if (stx.stx_size > buf_size) {
+            buf_size = stx.stx_size;
+            buf = realloc(buf, buf_size);
+        }
+        // whole file in one call; loop only on short reads
+        size_t done = 0;
+        ssize_t read_bytes = 1;
+        while (done < stx.stx_size && read_bytes > 0) {
+            read_bytes = read(fd, buf + done, stx.stx_size - done);
+            if (read_bytes > 0) {
+                done += read_bytes;
+            }
+        }
+        close(fd);
+        if (read_bytes == -1) {
+            fprintf(stderr, "Error while reading file %s/%s%s\n", job->folder_path, lister->prefix, entry->d_name);
+            status = 6;
+            break;
+        }
+        filebomb_result_record(result, clock_ns() - start, done);
+    }
+    free(buf);
+    return status;
+}
+
+static inline int filebomb_job_read(const struct filebomb_job * job, struct worker * worker, struct filebomb_result * result) {
+    filebomb_result_init(result);
+    struct filebomb_lister lister;
+    int status = filebomb_lister_open(&lister, job);
+    if (status) {
+        return status;
+    }
+    if (job->uring_files) {
+        status = filebomb_uring(job, IORING_OP_READ, &filebomb_lister_next_name, &lister, worker, result);
+    } else {
+        status = filebomb_read_sync(job, &lister, worker, result);
+    }
+    filebomb_lister_close(&lister);
+    return status;
+}
+
+// does one metadata operation on every file made by writer; failed operations are counted as errors
+static inline int filebomb_job_metadata(const struct filebomb_job * job, int op, struct worker * worker, struct filebomb_result * result) {
+    filebomb_result_init(result);
+    char moved_path [512];
+    sprintf(moved_path, "%s/" MOVED_FOLDER_NAME, job->folder_path);
+    if (op == FILEBOMB_MOVE && mkdir(moved_path, 0755) && errno != EEXIST) {
+        fprintf(stderr, "Can't make folder %s\n", moved_path);
+        return 3;
+    }
+    char name [MAX_NAME_LENGTH];
+    char file_path [600 + MAX_NAME_LENGTH];
+    char new_path [600 + MAX_NAME_LENGTH];
+    struct statx stx;
+    worker_start(worker);
+    for (long i = 0; i < job->files_count; ++i) {
+        int ret;
+        uint64_t start;
+        switch (op)
+        {
+        case FILEBOMB_STAT:
+            filebomb_file_name(job, i, "bin", name);
+            sprintf(file_path, "%s/%s", job->folder_path, name);
+            start = clock_ns();
+            ret = statx(AT_FDCWD, file_path, 0, STATX_BASIC_STATS, &stx);
+            break;
+        case FILEBOMB_OPEN:
+            filebomb_file_name(job, i, "bin", name);
+            sprintf(file_path, "%s/%s", job->folder_path, name);
+            start = clock_ns();
+            ret = open(file_path, O_RDONLY);
+            if (ret != -1) {
+                ret = close(ret);
+            }
+            break;
+        case FILEBOMB_RENAME:
+            filebomb_file_name(job, i, "bin", name);
+            sprintf(file_path, "%s/%s", job->folder_path, name);
+            filebomb_file_name(job, i, "renamed", name);
+            sprintf(new_path, "%s/%s", job->folder_path, name);
+            start = clock_ns();
+            ret = rename(file_path, new_path);
+            break;
+        case FILEBOMB_MOVE:
+            filebomb_file_name(job, i, "renamed", name);
+            sprintf(file_path, "%s/%s", job->folder_path, name);
+            sprintf(new_path, "%s/%ld.renamed", moved_path, i);
+            start = clock_ns();
+            ret = rename(file_path, new_path);
+            break;
+        default:
+            sprintf(file_path, "%s/%ld.renamed", moved_path, i);
+            start = clock_ns();
+            ret = unlink(file_path);
+            break;
+        }
+        if (ret == -1) {
+            fprintf(stderr, "Metadata operation failed on file %s: %s\n", file_path, strerror(errno));
+            result->errors++;
+            continue;
+        }
+        histogram_record(&result->latency, clock_ns() - start);
+    }
+    if (op == FILEBOMB_UNLINK) {
+        rmdir(moved_path);
+    }
+    return 0;
+}
+
+// makes tree of folders under worker folder level by level; every mkdir is recorded
+static inline int filebomb_job_mkdir(const struct filebomb_job * job, struct worker * worker, struct filebomb_result * result) {
+    filebomb_result_init(result);
+    int root_fd = open(job->folder_path, O_RDONLY | O_DIRECTORY);
+    if (root_fd == -1) {
+        fprintf(stderr, "Can't open folder %s\n", job->folder_path);
+        return 3;
+    }
+    char name [MAX_NAME_LENGTH];
+    worker_start(worker);
+    for (int level = 1; level <= job->depth; ++level) {
+        long width = filebomb_tree_width(job, level);
+        for (long i = 0; i < width; ++i) {
+            filebomb_folder_name(job, level, i, name);
+            uint64_t start = clock_ns();
+            if (mkdirat(root_fd, name, 0755) && errno != EEXIST) {
+                fprintf(stderr, "Can't make folder %s/%s: %s\n", job->folder_path, name, strerror(errno));
+                result->errors++;
+                continue;
+            }
+            histogram_record(&result->latency, clock_ns() - start);
+        }
+    }
+    close(root_fd);
+    return 0;
+}
+
+#endif
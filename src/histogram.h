@@ -0,0 +1,124 @@
+#ifndef IO_BENCHMARK_HISTOGRAM_H
+#define IO_BENCHMARK_HISTOGRAM_H
+
+// Log-linear latency histogram (HDR style) with fixed memory.
+// Values below 2^HISTOGRAM_SUB_BITS ns are exact, larger ones are grouped
+// into 2^HISTOGRAM_SUB_BITS sub-buckets per power of two, so relative error
+// stays below 1/32. Recording never allocates.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_EXPONENT 47 // about 39 hours in ns
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_SUB_COUNT)
+
+struct histogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets [HISTOGRAM_BUCKETS];
+};
+
+static inline uint64_t clock_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+static inline void histogram_init(struct histogram * h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+static inline int histogram_index(uint64_t value) {
+    if (value < HISTOGRAM_SUB_COUNT) {
+        return (int) value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > HISTOGRAM_MAX_EXPONENT) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+    int shift = exponent - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_COUNT + (int) ((value >> shift) - HISTOGRAM_SUB_COUNT);
+}
+
+// lowest value that falls into bucket
+static inline uint64_t histogram_bucket_value(int index) {
+    if (index < HISTOGRAM_SUB_COUNT) {
+        return index;
+    }
+    int shift = index / HISTOGRAM_SUB_COUNT - 1;
+    uint64_t mantissa = HISTOGRAM_SUB_COUNT + index % HISTOGRAM_SUB_COUNT;
+    return mantissa << shift;
+}
+
+static inline void histogram_record(struct histogram * h, uint64_t value) {
+    h->buckets[histogram_index(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value < h->min) {
+        h->min = value;
+    }
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+static inline void histogram_merge(struct histogram * dst, const struct histogram * src) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
+
+// percent is in range 0..100
+static inline uint64_t histogram_percentile(const struct histogram * h, double percent) {
+    if (h->count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t) (percent / 100.0 * h->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t value = histogram_bucket_value(i);
+            if (value < h->min) {
+                return h->min;
+            }
+            return value > h->max ? h->max : value;
+        }
+    }
+    return h->max;
+}
+
+static inline void histogram_print(const char * name, const struct histogram * h) {
+    if (h->count == 0) {
+        printf("%s latency: no operations\n", name);
+        return;
+    }
+    printf("%s latency: mean %.1f us, p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us (%llu ops)\n",
+        name,
+        (double) h->sum / h->count / 1e3,
+        histogram_percentile(h, 50) / 1e3,
+        histogram_percentile(h, 99) / 1e3,
+        histogram_percentile(h, 99.9) / 1e3,
+        h->max / 1e3,
+        (unsigned long long) h->count);
+}
+
+#endif
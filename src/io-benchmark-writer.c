@@ -1,39 +1,27 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include <time.h>
-#include <stdint.h>
+#include "io-worker.h"
 
-#define MODE_SERIAL 0
-#define MODE_RANDOM 1
-
-#define DEFAULT_BLOCK_SIZE 512
-#define DEFAULT_SOURCE_PATH "/dev/urandom"
-
-static char * file_path = 0;
-static char * source_path = DEFAULT_SOURCE_PATH;
-static int block_size = DEFAULT_BLOCK_SIZE;
-static int mode = MODE_SERIAL;
 static int help_required = 0;
-static long blocks_count = 0;
 
 static struct option opts [] = {
     {"file", required_argument, 0, 'f'},
     {"source", required_argument, 0, 's'},
-    {"block-size", required_argument, 0, 'b'},
     {"count", required_argument, 0, 'c'},
-    {"randomly", no_argument, 0, 'r'},
+    IO_JOB_LONG_OPTIONS,
     {"help", no_argument, 0, 'h'},
     {0, 0, 0, 0}
 };
 
 int main(int argc, char * argv []) {
+    struct io_job job;
+    io_job_init(&job);
     // read args
     int opt_c;
     int opt_i;
-    while ((opt_c = getopt_long(argc, argv, "f:s:b:c:rh", opts, &opt_i)) != -1)
+    while ((opt_c = getopt_long(argc, argv, "f:s:c:" IO_JOB_SHORT_OPTIONS "h", opts, &opt_i)) != -1)
     {
         switch (opt_c)
         {
@@ -42,24 +30,19 @@ int main(int argc, char * argv []) {
             return 1;
             break;
         case 'f':
-            file_path = optarg;
+            job.file_path = optarg;
             break;
         case 's':
-            source_path = optarg;
-            break;
-        case 'b':
-            block_size = atoi(optarg);
+            job.source_path = optarg;
             break;
         case 'c':
-            blocks_count = atol(optarg);
-            break;
-        case 'r':
-            mode = MODE_RANDOM;
+            job.blocks_count = atol(optarg);
             break;
         case 'h':
             help_required = 1;
             break;
         default:
+            io_job_parse_option(&job, opt_c, optarg);
             break;
         }
     }
@@ -68,71 +51,51 @@ int main(int argc, char * argv []) {
         printf("IO benchmark writer\n");
         printf("This utility writes large file.\n");
         printf("--file PATH | -f PATH sets path to file to write (required argument)\n");
-        printf("--source PATH | -s PATH sets the source of bytes. Default value is %s\n", DEFAULT_SOURCE_PATH);
-        printf("--block-size SIZE | -b SIZE sets block size to write each time. Default value is %d\n", DEFAULT_BLOCK_SIZE);
+        printf("--source PATH | -s PATH makes writer read bytes from PATH (e.g. /dev/urandom) instead of generating them\n");
         printf("--count COUNT | -c COUNT sets count of blocks to write\n");
-        printf("--randomly | -r makes writer to lseek each time to random block\n");
+        io_job_print_help();
         printf("--help | -h shows this tip\n");
         return 0;
     }
     // check options
-    if (!file_path) {
+    if (!job.file_path) {
         fprintf(stderr, "File path was not set. See help\n");
         return 2;
     }
-    if (block_size <= 0) {
-        fprintf(stderr, "Block size was not set properly. See help\n");
+    if (io_job_check(&job)) {
         return 3;
     }
-    if (blocks_count <= 0) {
+    if (job.blocks_count <= 0) {
         fprintf(stderr, "Blocks count was not set properly. See help\n");
         return 3;
     }
     // do writing
-    int fd = open(file_path, O_WRONLY | O_CREAT, 0644);
-    int source_fd = open(source_path, O_RDONLY);
-    if (fd == -1) {
-        fprintf(stderr, "Can't open file %s\n", file_path);
-        return 4;
-    }
-    if (source_fd == -1) {
-        fprintf(stderr, "Can't open source %s\n", source_path);
-        return 10;
+    if (!job.seed) {
+        job.seed = random_seed();
     }
-    if (mode == MODE_RANDOM) {
-        // prepare random
-        srand(time(0));
-        // write randomly
-        void * buf = malloc(block_size);
-        off_t random_off;
-        for (long i = 0; i < blocks_count; ++i) {
-            random_off = (rand() % blocks_count) * block_size;
-            lseek(fd, random_off, SEEK_SET);
-            if (read(source_fd, buf, block_size) != block_size) {
-                fprintf(stderr, "Error while reading source %s\n", source_path);
-                return 11;
-            }
-            if (write(fd, buf, block_size) != block_size) {
-                fprintf(stderr, "Error while writing file %s\n", file_path);
-                return 6;
-            }
+    struct io_result * result = malloc(sizeof(struct io_result));
+    int status = io_job_write(&job, 0, result);
+    if (!status) {
+        if (job.layout != LAYOUT_NONE) {
+            io_result_print_layout(result, job.layout);
+        }
+        histogram_print("Write", &result->latency[IO_WRITE]);
+        if (io_job_sync_name(&job)) {
+            histogram_print(io_job_sync_name(&job), &result->sync_latency);
+        }
+        if (job.engine == ENGINE_MMAP) {
+            io_result_print_faults(result);
+        }
+        if (job.flag_nowait) {
+            io_result_print_would_block(result);
+        }
+        if (job.rate > 0) {
+            io_result_print_rate(result, job.rate);
         }
-        free(buf);
-    } else {
-        void * buf = malloc(block_size);
-        for (long i = 0; i < blocks_count; ++i) {
-            if (read(source_fd, buf, block_size) != block_size) {
-                fprintf(stderr, "Error while reading source %s\n", source_path);
-                return 11;
-            }
-            if (write(fd, buf, block_size) != block_size) {
-                fprintf(stderr, "Error while writing file %s\n", file_path);
-                return 6;
-            }
+        if (job.flag_verify) {
+            io_result_print_verify(result, IO_WRITE, result->elapsed);
         }
-        free(buf);
     }
-    close(fd);
-    close(source_fd);
-    return 0;
+    free(result);
+    return status;
 }
@@ -1,36 +1,120 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <sys/wait.h>
 #include <time.h>
 #include <string.h>
-#include <assert.h>
-
-#define WRITER_PATH "build/io-benchmark-writer"
-#define READER_PATH "build/io-benchmark-reader"
+#include "io-worker.h"
+#include "report.h"
+#include "job-file.h"
+#include "page-cache.h"
+#include "kernel-stats.h"
 
 #define FILE_NAMES_START "io-benchmark-"
+#define TRACE_NAMES_START "io-benchmark-trace-"
+#define DEFAULT_TRACE_SPEED 1.0
 
-#define DEFAULT_BLOCK_SIZE 512
 #define DEFAULT_PROCESSES_COUNT 1
+#define DEFAULT_INTERVAL 1.0 // seconds, used for timed runs
+#define STEADY_STATE_TOLERANCE 0.1 // relative deviation from window mean
+#define STEADY_STATE_MIN_INTERVALS 3
+#define MAX_POINT_NAME 512
+
+#define OPERATION_READ 0 // reading, or mixed IO with --rwmix-read
+#define OPERATION_WRITE 1
 
 static char * folder_path = 0;
 static long total_size = 0;
-static long block_size = DEFAULT_BLOCK_SIZE;
 static int processes_count = DEFAULT_PROCESSES_COUNT;
-static int flag_randomly = 0;
 static int flag_no_clear = 0;
 static int flag_help = 0;
+static struct io_job job_template;
+static struct io_job * jobs = 0;
+static struct io_result * results = 0;
+static struct worker * workers = 0;
+static struct worker_report * worker_reports = 0;
+static int failed_workers = 0;
+static uint64_t verify_errors = 0; // read blocks which did not match, over all phases
+static struct payload payload;
+static double interval = 0;
+static int output_format = OUTPUT_TEXT;
+static struct report report;
+static struct placement placement;
+static const char * cpus_list = 0;
+static const char * job_file_path = 0;
+static int cache_mode = CACHE_COLD;
+static const char * trace_path = 0;
+static double trace_speed = DEFAULT_TRACE_SPEED;
+static struct kernel_stats kernel_stats; // of last run of workers
+
+// options which job file phases override; restored before every sweep point
+struct settings {
+    char * folder_path;
+    long total_size;
+    int processes_count;
+    double interval;
+    int flag_no_clear;
+    int cache_mode;
+    struct io_job job_template;
+    struct placement placement;
+    const char * cpus_list;
+};
+
+// files laid out by job file phases, reused by read phases with the same folder, size and workers
+struct layout {
+    char * folder_path; // NULL means nothing laid out
+    long total_size;
+    int processes_count;
+    int complete; // 0 when timed or random writes left files partly written
+    int flag_verify; // blocks are stamped for verification
+    int block_size; // of stamped blocks
+};
+
+// one row of results matrix printed after job file phases
+struct matrix_row {
+    char name [MAX_POINT_NAME + 32];
+    double mib;
+    double iops;
+    double mean;
+    double p99;
+};
+
+static struct settings baseline;
+static struct layout layout;
+static char point_name [MAX_POINT_NAME] = ""; // section and sweep values of running job file phase
+static struct matrix_row * matrix = 0;
+static int matrix_count = 0;
+static int matrix_capacity = 0;
+
+// throughput of one reporting interval
+struct sample {
+    double elapsed;
+    double iops;
+    double mib;
+};
+
+// state of interval reporting in current phase
+static struct sample * samples = 0;
+static int samples_count = 0;
+static int samples_capacity = 0;
+static struct io_counters last_counters;
+static double last_elapsed = 0;
 
 static struct option opts [] = {
     {"folder", required_argument, 0, 'f'},
     {"size", required_argument, 0, 's'},
-    {"block-size", required_argument, 0, 'b'},
     {"processes", required_argument, 0, 'p'},
-    {"randomly", no_argument, 0, 'r'},
+    {"interval", required_argument, 0, 'I'},
+    {"output-format", required_argument, 0, 'o'},
+    PLACEMENT_LONG_OPTIONS,
+    IO_JOB_LONG_OPTIONS,
     {"no-clear", no_argument, 0, 'c'},
+    {"job-file", required_argument, 0, 'J'},
+    {"cache", required_argument, 0, 'k'},
+    {"trace", required_argument, 0, 't'},
+    {"trace-speed", required_argument, 0, 'y'},
     {"help", no_argument, 0, 'h'},
     {0, 0, 0, 0}
 };
@@ -55,158 +139,422 @@ long interpret_string_as_bytes_size(char * s) {
     return result;
 }
 
+// applies option given on command line or in job file; returns 1 if parsing should stop
+int apply_option(int opt_c, char * arg) {
+    switch (opt_c)
+    {
+    case '?':
+        // something went wrong while parsing; stop
+        return 1;
+        break;
+    case 'f':
+        folder_path = arg;
+        break;
+    case 's':
+        total_size = interpret_string_as_bytes_size(arg);
+        break;
+    case 'p':
+        processes_count = atoi(arg);
+        break;
+    case 'I':
+        interval = parse_duration(arg);
+        break;
+    case 'o':
+        output_format = parse_output_format(arg);
+        break;
+    case 'c':
+        flag_no_clear = 1;
+        break;
+    case 'J':
+        job_file_path = arg;
+        break;
+    case 'k':
+        cache_mode = parse_cache_mode(arg);
+        break;
+    case 't':
+        trace_path = arg;
+        break;
+    case 'y':
+        trace_speed = atof(arg);
+        break;
+    case 'h':
+        flag_help = 1;
+        break;
+    default:
+        if (placement_parse_option(&placement, opt_c, arg)) {
+            if (opt_c == 'C') {
+                cpus_list = arg;
+            }
+            break;
+        }
+        io_job_parse_option(&job_template, opt_c, arg);
+        break;
+    }
+    return 0;
+}
+
 int read_args(int argc, char * argv []) {
+    io_job_init(&job_template);
+    placement_init(&placement);
     int opt_c;
     int opt_i;
-    while ((opt_c = getopt_long(argc, argv, "f:s:b:p:rh", opts, &opt_i)) != -1)
+    while ((opt_c = getopt_long(argc, argv, "f:s:p:I:o:cJ:k:t:y:" PLACEMENT_SHORT_OPTIONS IO_JOB_SHORT_OPTIONS "h", opts, &opt_i)) != -1)
     {
-        switch (opt_c)
-        {
-        case '?':
-            // something went wrong while parsing; stop
+        if (apply_option(opt_c, optarg)) {
             return 1;
-            break;
-        case 'f':
-            folder_path = optarg;
-            break;
-        case 's':
-            total_size = interpret_string_as_bytes_size(optarg);
-            break;
-        case 'b':
-            block_size = atol(optarg);
-            break;
-        case 'p':
-            processes_count = atoi(optarg);
-            break;
-        case 'r':
-            flag_randomly = 1;
-            break;
-        case 'c':
-            flag_no_clear = 1;
-            break;
-        case 'h':
-            flag_help = 1;
-            break;
-        default:
-            break;
         }
     }
     return 0;
 }
 
-char** str_split(char* a_str, const char a_delim)
-{
-    char** result    = 0;
-    size_t count     = 0;
-    char* tmp        = a_str;
-    char* last_comma = 0;
-    char delim[2];
-    delim[0] = a_delim;
-    delim[1] = 0;
+// applies job file key as long option; returns 0 or prints error
+int apply_job_option(const char * key, char * value) {
+    for (struct option * opt = opts; opt->name; ++opt) {
+        if (strcmp(opt->name, key)) {
+            continue;
+        }
+        if (opt->val == 'J' || opt->val == 't' || opt->val == 'o' || opt->val == 'h') {
+            fprintf(stderr, "Option %s can't be used in job file. See help\n", key);
+            return 1;
+        }
+        if (opt->has_arg == no_argument) {
+            // flags may be swept as 0 and 1
+            if (value && !strcmp(value, "0")) {
+                return 0;
+            }
+            if (value && strcmp(value, "1")) {
+                fprintf(stderr, "Flag %s in job file takes no value but 0 or 1. See help\n", key);
+                return 1;
+            }
+            return apply_option(opt->val, 0);
+        }
+        if (!value) {
+            fprintf(stderr, "Option %s in job file needs a value. See help\n", key);
+            return 1;
+        }
+        return apply_option(opt->val, value);
+    }
+    fprintf(stderr, "Unknown key %s in job file. See help\n", key);
+    return 1;
+}
 
-    /* Count how many elements will be extracted. */
-    while (*tmp)
-    {
-        if (a_delim == *tmp)
-        {
-            count++;
-            last_comma = tmp;
+int prepare_jobs() {
+    jobs = malloc(processes_count * sizeof(struct io_job));
+    results = malloc(processes_count * sizeof(struct io_result));
+    workers = malloc(processes_count * sizeof(struct worker));
+    worker_reports = malloc(processes_count * sizeof(struct worker_report));
+    if (!jobs || !results || !workers || !worker_reports) {
+        fprintf(stderr, "Can't allocate memory for %d workers\n", processes_count);
+        return 1;
+    }
+    if (!job_template.seed) {
+        job_template.seed = random_seed();
+    }
+    uint64_t seed = job_template.seed;
+    // all writers copy from one generated pool
+    if (payload_init(&payload, job_template.compress_percent, job_template.dedupe_percent, seed)) {
+        fprintf(stderr, "Can't allocate payload\n");
+        return 1;
+    }
+    for (int i = 0; i < processes_count; ++i) {
+        jobs[i] = job_template;
+        char * file_path = malloc(strlen(folder_path) + sizeof(FILE_NAMES_START) + 16);
+        sprintf(file_path, "%s/" FILE_NAMES_START "%d.bin", folder_path, i);
+        jobs[i].file_path = file_path;
+        jobs[i].blocks_count = total_size / processes_count / job_template.block_size;
+        jobs[i].seed = seed + i;
+        jobs[i].verify_seed = seed + i;
+        jobs[i].payload = &payload;
+        if (!job_template.flag_rate_per_worker) {
+            jobs[i].rate = job_template.rate / processes_count;
         }
-        tmp++;
+        workers[i].placement = &placement;
     }
+    return 0;
+}
 
-    /* Add space for trailing token. */
-    count += last_comma < (a_str + strlen(a_str) - 1);
+void release_jobs() {
+    for (int i = 0; i < processes_count; ++i) {
+        free((char *) jobs[i].file_path);
+    }
+    free(jobs);
+    free(results);
+    free(workers);
+    free(worker_reports);
+    payload_free(&payload);
+}
 
-    /* Add space for terminating null string so caller
-       knows where the list of returned strings ends. */
-    count++;
+int run_writer(struct worker * worker) {
+    return io_job_write(&jobs[worker->id], worker, &results[worker->id]);
+}
 
-    result = malloc(sizeof(char*) * count);
+int run_reader(struct worker * worker) {
+    return io_job_read(&jobs[worker->id], worker, &results[worker->id]);
+}
 
-    if (result)
-    {
-        size_t idx  = 0;
-        char* token = strtok(a_str, delim);
+int run_replayer(struct worker * worker) {
+    return io_job_replay(&jobs[worker->id], worker, &results[worker->id]);
+}
 
-        while (token)
-        {
-            assert(idx < count);
-            *(result + idx++) = strdup(token);
-            token = strtok(0, delim);
+// sums running counters of all workers
+void collect_counters(struct io_counters * sum) {
+    memset(sum, 0, sizeof(*sum));
+    for (int i = 0; i < processes_count; ++i) {
+        struct io_counters * live = &results[i].live;
+        for (int op = IO_READ; op <= IO_WRITE; ++op) {
+            sum->ops[op] += __atomic_load_n(&live->ops[op], __ATOMIC_RELAXED);
+            sum->bytes[op] += __atomic_load_n(&live->bytes[op], __ATOMIC_RELAXED);
+            sum->latency[op] += __atomic_load_n(&live->latency[op], __ATOMIC_RELAXED);
         }
-        assert(idx == count - 1);
-        *(result + idx) = 0;
     }
+}
 
-    return result;
+// called by run_workers every interval
+void report_interval(double elapsed) {
+    struct io_counters now;
+    collect_counters(&now);
+    double time = elapsed - last_elapsed;
+    struct sample sample = {elapsed, 0, 0};
+    if (output_format == OUTPUT_TEXT) {
+        printf("[%7.1f s]", elapsed);
+    }
+    for (int op = IO_READ; op <= IO_WRITE; ++op) {
+        uint64_t ops = now.ops[op] - last_counters.ops[op];
+        uint64_t bytes = now.bytes[op] - last_counters.bytes[op];
+        uint64_t latency = now.latency[op] - last_counters.latency[op];
+        if (!ops) {
+            continue;
+        }
+        if (output_format == OUTPUT_TEXT) {
+            printf(" %s %.0f IOPS, %.1f MiB/s, mean %.1f us;", op == IO_READ ? "read" : "write",
+                ops / time, bytes / time / (1024 * 1024), (double) latency / ops / 1e3);
+        }
+        sample.iops += ops / time;
+        sample.mib += bytes / time / (1024 * 1024);
+    }
+    if (output_format == OUTPUT_TEXT) {
+        printf("\n");
+        fflush(stdout);
+    }
+    last_counters = now;
+    last_elapsed = elapsed;
+    // ramp intervals do not count for steady state
+    if (elapsed - time < job_template.ramp) {
+        return;
+    }
+    if (samples_count == samples_capacity) {
+        samples_capacity = samples_capacity ? samples_capacity * 2 : 64;
+        samples = realloc(samples, samples_capacity * sizeof(struct sample));
+    }
+    samples[samples_count++] = sample;
 }
 
-void print_args(char * const * args) {
-    int i = 0;
-    printf("args: ");
-    while (args[i] != 0)
-    {
-        printf("%s ", args[i]);
-        ++i;
+// prints spread of interval throughput and the longest trailing window
+// where every interval stays within tolerance of the window mean
+void print_steady_state() {
+    if (samples_count == 0) {
+        return;
+    }
+    double sum = 0;
+    double min = samples[0].iops;
+    double max = samples[0].iops;
+    for (int i = 0; i < samples_count; ++i) {
+        sum += samples[i].iops;
+        if (samples[i].iops < min) {
+            min = samples[i].iops;
+        }
+        if (samples[i].iops > max) {
+            max = samples[i].iops;
+        }
     }
-    printf("\n");
+    printf("Interval IOPS: mean %.0f, min %.0f, max %.0f (%d intervals)\n", sum / samples_count, min, max, samples_count);
+    int first = samples_count;
+    double window_iops = 0;
+    double window_mib = 0;
+    for (int i = samples_count - 1; i >= 0; --i) {
+        double iops = 0;
+        double mib = 0;
+        for (int j = i; j < samples_count; ++j) {
+            iops += samples[j].iops;
+            mib += samples[j].mib;
+        }
+        iops /= samples_count - i;
+        mib /= samples_count - i;
+        int steady = 1;
+        for (int j = i; j < samples_count && steady; ++j) {
+            if (samples[j].iops < iops * (1 - STEADY_STATE_TOLERANCE) || samples[j].iops > iops * (1 + STEADY_STATE_TOLERANCE)) {
+                steady = 0;
+            }
+        }
+        if (!steady) {
+            break;
+        }
+        first = i;
+        window_iops = iops;
+        window_mib = mib;
+    }
+    int window = samples_count - first;
+    if (window < STEADY_STATE_MIN_INTERVALS) {
+        printf("Steady state: not reached\n");
+        return;
+    }
+    double since = samples[first].elapsed - interval;
+    printf("Steady state: since %.1f s (%d intervals), %.0f IOPS, %.1f MiB/s\n", since, window, window_iops, window_mib);
 }
 
-int fork_and_exec(const char * path, char * const * args) {
-    //print_args(args);
-    pid_t pid = fork();
-    if (pid < 0) {
-        return 1;
-    } else if (pid == 0) { // child
-        char * env [] = {NULL};
-        if(execve(path, args, env) == -1) {
-            fprintf(stderr, "Execution of %s failed\n", path);
-            exit(2);
+double launch_tests(int (* func) (struct worker *), struct io_result * total) {
+    struct monitor monitor = {interval, &report_interval};
+    samples_count = 0;
+    memset(&last_counters, 0, sizeof(last_counters));
+    last_elapsed = 0;
+    kernel_stats_init(&kernel_stats, folder_path);
+    kernel_stats_begin(&kernel_stats);
+    double time = run_workers(workers, processes_count, func, interval > 0 ? &monitor : 0);
+    // timed runs are measured over runtime only
+    if (job_template.runtime > 0) {
+        time = job_template.runtime;
+    }
+    // merge results of all workers
+    io_result_init(total);
+    for (int i = 0; i < processes_count; ++i) {
+        if (workers[i].status) {
+            fprintf(stderr, "Test %d failed with code %d\n", i, workers[i].status);
+            ++failed_workers;
+            continue;
         }
+        io_result_merge(total, &results[i]);
     }
-    return 0;
+    verify_errors += total->verify_errors;
+    return time;
+}
+
+// counters of last run till now, so write phases include their sync; phases of one run share them
+void summarize_kernel(const struct io_result * total, struct kernel_summary * summary) {
+    kernel_stats_end(&kernel_stats);
+    kernel_stats_summarize(&kernel_stats, total->bytes[IO_READ], total->bytes[IO_WRITE] + total->bytes[IO_LAYOUT], summary);
 }
 
-int launch_writer(int id) {
-    char args_string [512];
-    long blocks_count = total_size / processes_count / block_size;
-    sprintf(args_string, WRITER_PATH " --file %s/" FILE_NAMES_START "%d.bin --block-size %ld --count %ld", folder_path, id, block_size, blocks_count);
-    if (flag_randomly) {
-        strcat(args_string, " --randomly");
+void print_kernel(const struct io_result * total) {
+    struct kernel_summary summary;
+    summarize_kernel(total, &summary);
+    kernel_summary_print(&summary);
+}
+
+// passes op side of last phase to machine-readable report
+void add_phase(const char * kind, int op, double time, const struct io_result * total) {
+    // job file phases are named by section, kind and sweep values
+    char name [MAX_POINT_NAME + 32];
+    if (point_name[0]) {
+        const char * axes = strchr(point_name, ' ');
+        int section_length = axes ? (int) (axes - point_name) : (int) strlen(point_name);
+        snprintf(name, sizeof(name), "%.*s/%s%s", section_length, point_name, kind, axes ? axes : "");
+    } else {
+        snprintf(name, sizeof(name), "%s", kind);
     }
-    char ** args = str_split(args_string, ' ');
-    return fork_and_exec(WRITER_PATH, args);
+    if (matrix_count == matrix_capacity) {
+        matrix_capacity = matrix_capacity ? matrix_capacity * 2 : 64;
+        matrix = realloc(matrix, matrix_capacity * sizeof(struct matrix_row));
+    }
+    struct matrix_row * row = &matrix[matrix_count++];
+    const struct histogram * h = &total->latency[op];
+    snprintf(row->name, sizeof(row->name), "%s", name);
+    row->mib = time > 0 ? total->bytes[op] / time / (1024 * 1024) : 0;
+    row->iops = time > 0 ? h->count / time : 0;
+    row->mean = h->count ? (double) h->sum / h->count / 1e3 : 0;
+    row->p99 = histogram_percentile(h, 99) / 1e3;
+    struct kernel_summary kernel;
+    summarize_kernel(total, &kernel);
+    struct phase_report phase = {name, time, total->bytes[op], total->latency[op].count, 0, &total->latency[op], processes_count, worker_reports, 0, 0, &kernel};
+    for (int i = 0; i < processes_count; ++i) {
+        struct worker_report * w = &worker_reports[i];
+        w->id = i;
+        w->status = workers[i].status;
+        w->elapsed = workers[i].elapsed;
+        w->bytes = results[i].bytes[op];
+        w->ops = results[i].latency[op].count;
+        // workers stop at first failed operation; mismatched blocks do not stop them
+        w->errors = (workers[i].status ? 1 : 0) + (op == IO_READ ? results[i].verify_errors : 0);
+        w->user_time = workers[i].user_time;
+        w->sys_time = workers[i].sys_time;
+        if (op == IO_LAYOUT) {
+            // lay out pass runs before start, outside of CPU accounting
+            w->elapsed = results[i].layout_time;
+            w->user_time = 0;
+            w->sys_time = 0;
+        }
+        w->latency = &results[i].latency[op];
+        phase.errors += w->errors;
+    }
+    report_phase(&report, &phase);
+}
+
+// target IOPS of all workers together; 0 when not rate limited
+double total_rate() {
+    return job_template.flag_rate_per_worker ? job_template.rate * processes_count : job_template.rate;
 }
 
-int launch_reader(int id) {
-    char args_string [512];
-    sprintf(args_string, READER_PATH " --file %s/" FILE_NAMES_START "%d.bin --block-size %ld", folder_path, id, block_size);
-    if (flag_randomly) {
-        strcat(args_string, " --randomly");
+void add_config(int argc, char * argv []) {
+    char command [4096] = "";
+    size_t length = 0;
+    for (int i = 0; i < argc && length < sizeof(command); ++i) {
+        length += snprintf(command + length, sizeof(command) - length, i ? " %s" : "%s", argv[i]);
     }
-    char ** args = str_split(args_string, ' ');
-    return fork_and_exec(READER_PATH, args);
+    report_config_string(&report, "command", command);
+    report_config_string(&report, "job_file", job_file_path);
+    report_config_string(&report, "folder", folder_path);
+    report_config_integer(&report, "size", total_size);
+    report_config_number(&report, "processes", processes_count);
+    report_config_string(&report, "cpus", cpus_list);
+    report_config_number(&report, "numa_node", placement.numa_node);
+    report_config_string(&report, "cache", cache_mode >= 0 ? cache_mode_name(cache_mode) : 0);
+    report_config_number(&report, "block_size", job_template.block_size);
+    report_config_string(&report, "mode", job_template.mode == MODE_RANDOM ? "random" : "serial");
+    report_config_string(&report, "engine", engine_name(job_template.engine));
+    report_config_number(&report, "iodepth", job_template.iodepth);
+    report_config_number(&report, "batch", job_template.batch);
+    report_config_number(&report, "direct", job_template.flag_direct);
+    report_config_number(&report, "rwmix_read", job_template.rwmix_read);
+    report_config_number(&report, "fsync_every", job_template.fsync_every);
+    report_config_number(&report, "fdatasync_every", job_template.fdatasync_every);
+    report_config_number(&report, "sync_mode", job_template.sync_mode);
+    report_config_number(&report, "compress", job_template.compress_percent);
+    report_config_number(&report, "dedupe", job_template.dedupe_percent);
+    report_config_number(&report, "runtime", job_template.runtime);
+    report_config_number(&report, "ramp", job_template.ramp);
+    report_config_number(&report, "rate", total_rate());
+    report_config_string(&report, "layout", job_template.layout >= 0 ? layout_name(job_template.layout) : 0);
+    report_config_number(&report, "verify", job_template.flag_verify);
+    report_config_string(&report, "trace", trace_path);
+    if (trace_path) {
+        report_config_number(&report, "trace_speed", trace_speed);
+    }
+    report_config_integer(&report, "seed", job_template.seed);
 }
 
-double launch_tests(int (* launch_func) (int)) {
-    struct timespec start_time;
-    timespec_get(&start_time, TIME_UTC);
-    // launch
+// seconds of all workers in last phase
+double busy_time() {
+    double busy = 0;
     for (int i = 0; i < processes_count; ++i) {
-        if (launch_func(i)) {
-            fprintf(stderr, "Launch of test %d failed\n", i);
-        }
+        busy += workers[i].elapsed;
     }
-    // wait for writers to finish
-    int writer_status;
+    return busy;
+}
+
+// prints CPU time of last phase summed over workers
+void print_cpu(uint64_t bytes, uint64_t ops) {
+    double user_time = 0;
+    double sys_time = 0;
     for (int i = 0; i < processes_count; ++i) {
-        wait(&writer_status);
+        user_time += workers[i].user_time;
+        sys_time += workers[i].sys_time;
     }
-    // return delta
-    struct timespec end_time;
-    timespec_get(&end_time, TIME_UTC);
-    return (end_time.tv_sec-start_time.tv_sec) + 1e-9 * (end_time.tv_nsec-start_time.tv_nsec);
+    double cpu = user_time + sys_time;
+    printf("CPU: user %.3f s, sys %.3f s, %.3f s per GiB, %.3f s per million ops\n",
+        user_time, sys_time, cpu_per_gib(cpu, bytes), cpu_per_m_ops(cpu, ops));
+}
+
+void print_throughput(const char * name, uint64_t bytes, uint64_t ops, double time) {
+    printf("%s throughput: %.1f MiB/s, %.0f IOPS\n", name, bytes / time / (1024 * 1024), ops / time);
 }
 
 double do_sync() {
@@ -218,20 +566,30 @@ double do_sync() {
     return (end_time.tv_sec-start_time.tv_sec) + 1e-9 * (end_time.tv_nsec-start_time.tv_nsec);
 }
 
-int clear() {
-    for (int i = 0; i < processes_count; ++i) {
+int clear_files(const char * folder, int count) {
+    for (int i = 0; i < count; ++i) {
         char command [512];
-        sprintf(command, "rm %s/%s%d.bin", folder_path, FILE_NAMES_START, i);
+        sprintf(command, "rm %s/%s%d.bin", folder, FILE_NAMES_START, i);
         system(command);
     }
     return 0;
 }
 
-int drop_cache_if_root() {
-    if (getuid() == 0) { // if root
-        system("echo 1 > /proc/sys/vm/drop_caches");
+int clear() {
+    return clear_files(folder_path, processes_count);
+}
+
+// brings files of workers into cache mode before reading
+void prepare_cache() {
+    struct cache_state state;
+    cache_state_init(&state, cache_mode);
+    for (int i = 0; i < processes_count; ++i) {
+        cache_prepare_file(&state, jobs[i].file_path);
+    }
+    cache_state_check(&state);
+    if (output_format == OUTPUT_TEXT) {
+        cache_state_print(&state);
     }
-    return 0;
 }
 
 void print_help() {
@@ -239,27 +597,27 @@ void print_help() {
     printf("This utility writes and reads a few large files and records operation time.\n");
     printf("--folder PATH | -f PATH sets folder to create files (required argument)\n");
     printf("--size SIZE | -s SIZE sets total size to write and read in bytes. You can use K (kibibytes), M (mebibytes) and G (gibibytes) ending (required argument)\n");
-    printf("--block-size SIZE | -b SIZE sets block size to write and read each time. Default value is %d\n", DEFAULT_BLOCK_SIZE);
-    printf("--processes COUNT | -p COUNT sets count of parallel processes\n");
-    printf("--randomly | -r makes tests to lseek each time to random block\n");
+    printf("--processes COUNT | -p COUNT sets count of parallel workers. Workers are threads started together\n");
+    printf("--output-format FORMAT | -o FORMAT sets format of results: text (default), json or csv. JSON and CSV include config and per-worker results\n");
+    placement_print_help();
+    cache_print_help();
+    printf("--interval TIME | -I TIME prints IOPS, throughput and mean latency every TIME while phase runs. Default value is %.0f s for timed runs, otherwise off\n", DEFAULT_INTERVAL);
+    io_job_print_help();
+    printf("--job-file PATH | -J PATH runs named phases of job file instead of one write and read. Sections [NAME] are phases; keys are long options without dashes, and operation=read (default) or write. Values with commas are sweep axes, e.g. block-size=4k,16k,64k and processes=1,4,16, and phase runs every combination of them; cpus lists keep their commas, and values split at | instead, e.g. cpus=0-3,8|0-7. [global] section and command line options apply to all phases. Read phases reuse files laid out once for the same folder, size and processes. A results matrix is printed at the end\n");
+    printf("--trace PATH | -t PATH replays IO trace instead of writing and reading: text lines of TIME OP FILE OFFSET LENGTH (seconds, R or W, name, bytes) or binary records after IOTRACE1 magic. Trace files are laid out in folder before replay and records are dealt to workers round robin. Works with sync and io_uring engines; --size is not needed. With --direct every offset and length must be a multiple of direct IO alignment of folder, otherwise trace is refused\n");
+    printf("--trace-speed FACTOR | -y FACTOR replays trace FACTOR times faster than recorded, with latency counted from recorded time of each operation; 0 replays as fast as possible. Default value is %.0f\n", DEFAULT_TRACE_SPEED);
     printf("--no-clear prevents benchmark from clearing temp files\n");
     printf("--help | -h shows this tip\n");
 }
 
-int main(int argc, char * argv []) {
-    if (read_args(argc, argv)) {
-        return 1; // error already printed
-    }
-    // check args
-    if (flag_help) {
-        print_help();
-        return 0;
-    }
+// checks options of benchmark or of job file phase; returns exit code
+int check_args() {
     if (!folder_path) {
         fprintf(stderr, "Folder path was not set. See help\n");
         return 2;
     }
-    if (total_size <= 0) {
+    // trace replay takes sizes from trace
+    if (total_size <= 0 && !trace_path) {
         fprintf(stderr, "Size was not set. See help\n");
         return 2;
     }
@@ -267,27 +625,559 @@ int main(int argc, char * argv []) {
         fprintf(stderr, "Process count was not set properly. See help\n");
         return 2;
     }
-    if (block_size <= 0) {
-        fprintf(stderr, "Block size was not set properly. See help\n");
+    if (io_job_check(&job_template)) {
+        return 2;
+    }
+    if (interval < 0) {
+        fprintf(stderr, "Interval was not set properly. See help\n");
         return 2;
     }
-    // do writing tests
-    double writing_time = launch_tests(&launch_writer);
+    if (interval == 0 && job_template.runtime > 0) {
+        interval = DEFAULT_INTERVAL;
+    }
+    if (placement_check(&placement)) {
+        return 2;
+    }
+    if (cache_mode < 0) {
+        fprintf(stderr, "Cache mode was not set properly. See help\n");
+        return 2;
+    }
+    if (output_format < 0) {
+        fprintf(stderr, "Output format was not set properly. See help\n");
+        return 2;
+    }
+    return 0;
+}
+
+void run_write_phase(struct io_result * total) {
+    double writing_time = launch_tests(&run_writer, total);
     // sync
     writing_time += do_sync();
     // report
-    printf("Written in %f s\n", writing_time);
-    // flush disk cache (root only)
-    drop_cache_if_root();
-    // do reading tests
-    double reading_time = launch_tests(&launch_reader);
+    if (output_format == OUTPUT_TEXT) {
+        if (job_template.layout != LAYOUT_NONE) {
+            io_result_print_layout(total, job_template.layout);
+        }
+        printf("Written in %f s\n", writing_time);
+        if (job_template.runtime > 0) {
+            print_throughput("Write", total->bytes[IO_WRITE], total->latency[IO_WRITE].count, job_template.runtime);
+        }
+        histogram_print("Write", &total->latency[IO_WRITE]);
+        if (io_job_sync_name(&job_template)) {
+            histogram_print(io_job_sync_name(&job_template), &total->sync_latency);
+        }
+        if (job_template.engine == ENGINE_MMAP) {
+            io_result_print_faults(total);
+        }
+        if (job_template.flag_nowait) {
+            io_result_print_would_block(total);
+        }
+        if (job_template.rate > 0) {
+            io_result_print_rate(total, total_rate());
+        }
+        if (job_template.flag_verify) {
+            io_result_print_verify(total, IO_WRITE, busy_time());
+        }
+        print_cpu(total->bytes[IO_WRITE], total->latency[IO_WRITE].count);
+        print_kernel(total);
+        print_steady_state();
+    }
+    // allocation cost of lay out pass is reported apart from writes
+    if (job_template.layout != LAYOUT_NONE) {
+        add_phase("layout", IO_LAYOUT, total->layout_time, total);
+    }
+    add_phase("write", IO_WRITE, writing_time, total);
+}
+
+// reads laid out files; with read mix also writes to them
+void run_read_phase(struct io_result * total) {
+    prepare_cache();
+    double reading_time = launch_tests(&run_reader, total);
     // report
-    printf("Read in %f s\n", reading_time);
+    if (output_format == OUTPUT_TEXT) {
+        if (job_template.rwmix_read < 100) {
+            printf("Mixed in %f s\n", reading_time);
+            print_throughput("Read", total->bytes[IO_READ], total->latency[IO_READ].count, reading_time);
+            print_throughput("Write", total->bytes[IO_WRITE], total->latency[IO_WRITE].count, reading_time);
+            histogram_print("Read", &total->latency[IO_READ]);
+            histogram_print("Write", &total->latency[IO_WRITE]);
+            if (io_job_sync_name(&job_template)) {
+                histogram_print(io_job_sync_name(&job_template), &total->sync_latency);
+            }
+        } else {
+            printf("Read in %f s\n", reading_time);
+            if (job_template.runtime > 0) {
+                print_throughput("Read", total->bytes[IO_READ], total->latency[IO_READ].count, reading_time);
+            }
+            histogram_print("Read", &total->latency[IO_READ]);
+        }
+        if (job_template.engine == ENGINE_MMAP) {
+            io_result_print_faults(total);
+        }
+        if (job_template.flag_nowait) {
+            io_result_print_would_block(total);
+        }
+        if (job_template.rate > 0) {
+            io_result_print_rate(total, total_rate());
+        }
+        if (job_template.flag_verify) {
+            io_result_print_verify(total, IO_READ, busy_time());
+        }
+        print_cpu(total->bytes[IO_READ] + total->bytes[IO_WRITE], total->latency[IO_READ].count + total->latency[IO_WRITE].count);
+        print_kernel(total);
+        print_steady_state();
+    }
+    if (job_template.rwmix_read < 100) {
+        add_phase("mixed-read", IO_READ, reading_time, total);
+        add_phase("mixed-write", IO_WRITE, reading_time, total);
+    } else {
+        add_phase("read", IO_READ, reading_time, total);
+    }
+}
+
+void save_settings() {
+    struct settings current = {folder_path, total_size, processes_count, interval, flag_no_clear, cache_mode, job_template, placement, cpus_list};
+    baseline = current;
+}
+
+void restore_settings() {
+    folder_path = baseline.folder_path;
+    total_size = baseline.total_size;
+    processes_count = baseline.processes_count;
+    interval = baseline.interval;
+    flag_no_clear = baseline.flag_no_clear;
+    cache_mode = baseline.cache_mode;
+    job_template = baseline.job_template;
+    placement = baseline.placement;
+    cpus_list = baseline.cpus_list;
+}
+
+// removes files of last layout
+void clear_layout() {
+    if (layout.folder_path) {
+        clear_files(layout.folder_path, layout.processes_count);
+        free(layout.folder_path);
+        layout.folder_path = 0;
+    }
+}
+
+// tells whether files of current workers are laid out; verified reads need blocks stamped at their block size
+int layout_matches() {
+    return layout.folder_path && layout.complete && !strcmp(layout.folder_path, folder_path)
+        && layout.total_size == total_size && layout.processes_count == processes_count
+        && (!job_template.flag_verify || (layout.flag_verify && layout.block_size == job_template.block_size));
+}
+
+// remembers files written by current workers, replacing the previous layout
+void set_layout(int complete) {
+    if (layout.folder_path && !layout_matches()) {
+        clear_layout();
+    }
+    if (!layout.folder_path) {
+        layout.folder_path = strdup(folder_path);
+    }
+    layout.total_size = total_size;
+    layout.processes_count = processes_count;
+    layout.complete = complete;
+    layout.flag_verify = job_template.flag_verify;
+    layout.block_size = job_template.block_size;
+}
+
+// writes files for read phase with large serial untimed writes, or blocks of read size when
+// they are verified; returns 0 or exit code
+int lay_out(struct io_result * total) {
+    set_layout(0);
+    struct io_job * saved = malloc(processes_count * sizeof(struct io_job));
+    memcpy(saved, jobs, processes_count * sizeof(struct io_job));
+    long file_size = total_size / processes_count;
+    for (int i = 0; i < processes_count; ++i) {
+        struct io_job * job = &jobs[i];
+        if (file_size >= LAYOUT_BLOCK_SIZE && !job->flag_verify) {
+            job->block_size = LAYOUT_BLOCK_SIZE;
+        }
+        job->blocks_count = file_size / job->block_size;
+        job->mode = MODE_SERIAL;
+        job->engine = ENGINE_SYNC;
+        job->flag_direct = 0;
+        job->fsync_every = 0;
+        job->fdatasync_every = 0;
+        job->sync_mode = SYNC_MODE_NONE;
+        job->runtime = 0;
+        job->ramp = 0;
+        job->rate = 0;
+        job->layout = LAYOUT_NONE;
+    }
+    double saved_interval = interval;
+    interval = 0;
+    int failed = failed_workers;
+    double time = launch_tests(&run_writer, total) + do_sync();
+    interval = saved_interval;
+    memcpy(jobs, saved, processes_count * sizeof(struct io_job));
+    free(saved);
+    if (failed_workers > failed) {
+        return 4;
+    }
+    if (output_format == OUTPUT_TEXT) {
+        printf("Laid out %d files in %f s\n", processes_count, time);
+    }
+    layout.complete = 1;
+    return 0;
+}
+
+// runs one sweep point of job file section; returns 0 or exit code
+int run_job_point(const struct job_file_section * section, long point, struct io_result * total) {
+    restore_settings();
+    int operation = OPERATION_READ;
+    char axes [MAX_POINT_NAME] = "";
+    size_t axes_length = 0;
+    // option values must live while the point runs
+    char * values [MAX_JOB_FILE_ENTRIES];
+    int values_count = 0;
+    int status = 0;
+    for (int i = 0; i < section->entries_count && !status; ++i) {
+        const struct job_file_entry * entry = &section->entries[i];
+        char buf [MAX_JOB_FILE_LINE];
+        char * value = job_file_value(section, i, point, buf);
+        if (entry->values_count > 1 && axes_length < sizeof(axes)) {
+            axes_length += snprintf(axes + axes_length, sizeof(axes) - axes_length, " %s=%s", entry->key, value);
+        }
+        if (!strcmp(entry->key, "operation")) {
+            if (value && !strcmp(value, "read")) {
+                operation = OPERATION_READ;
+            } else if (value && !strcmp(value, "write")) {
+                operation = OPERATION_WRITE;
+            } else {
+                fprintf(stderr, "Operation of phase %s must be read or write. See help\n", section->name);
+                status = 2;
+            }
+            continue;
+        }
+        if (value) {
+            value = values[values_count++] = strdup(value);
+        }
+        if (apply_job_option(entry->key, value)) {
+            status = 2;
+        }
+    }
+    if (!status) {
+        status = check_args();
+    }
+    snprintf(point_name, sizeof(point_name), "%s%s", section->name, axes);
+    if (!status && prepare_jobs()) {
+        status = 2;
+    }
+    if (!status) {
+        if (output_format == OUTPUT_TEXT) {
+            printf("== %s ==\n", point_name);
+        }
+        if (operation == OPERATION_WRITE) {
+            // timed or random writes may leave files partly written
+            set_layout(job_template.mode == MODE_SERIAL && job_template.runtime == 0);
+            run_write_phase(total);
+        } else {
+            if (!layout_matches()) {
+                status = lay_out(total);
+            }
+            if (!status) {
+                run_read_phase(total);
+            }
+        }
+        release_jobs();
+    }
+    for (int i = 0; i < values_count; ++i) {
+        free(values[i]);
+    }
+    return status;
+}
+
+// moves keys which define layout to front, so sweep changes files as rarely as possible
+void order_layout_axes(struct job_file_section * section) {
+    static const char * keys [] = {"folder", "size", "processes"};
+    int front = 0;
+    for (int k = 0; k < 3; ++k) {
+        for (int i = front; i < section->entries_count; ++i) {
+            if (!strcmp(section->entries[i].key, keys[k])) {
+                struct job_file_entry entry = section->entries[i];
+                memmove(&section->entries[front + 1], &section->entries[front], (i - front) * sizeof(struct job_file_entry));
+                section->entries[front++] = entry;
+            }
+        }
+    }
+}
+
+void print_matrix() {
+    int width = 5;
+    for (int i = 0; i < matrix_count; ++i) {
+        int length = (int) strlen(matrix[i].name);
+        if (length > width) {
+            width = length;
+        }
+    }
+    printf("\n%-*s %12s %12s %12s %12s\n", width, "Phase", "MiB/s", "IOPS", "Mean us", "P99 us");
+    for (int i = 0; i < matrix_count; ++i) {
+        struct matrix_row * row = &matrix[i];
+        printf("%-*s %12.1f %12.0f %12.1f %12.1f\n", width, row->name, row->mib, row->iops, row->mean, row->p99);
+    }
+}
+
+// runs every sweep point of every job file section; returns exit code
+int run_job_file(int argc, char * argv []) {
+    struct job_file job_file;
+    static const char * list_keys [] = {"cpus", 0};
+    if (job_file_load(&job_file, job_file_path, list_keys)) {
+        job_file_free(&job_file);
+        return 2;
+    }
+    // global section applies on top of command line; values live till exit
+    int status = 0;
+    for (int i = 0; i < job_file.global.entries_count && !status; ++i) {
+        struct job_file_entry * entry = &job_file.global.entries[i];
+        if (entry->values_count > 1) {
+            fprintf(stderr, "Sweep axis %s must be set in a phase section. See help\n", entry->key);
+            status = 2;
+        } else if (apply_job_option(entry->key, entry->value)) {
+            status = 2;
+        }
+    }
+    if (status) {
+        job_file_free(&job_file);
+        return status;
+    }
+    // one seed makes all points repeatable
+    if (!job_template.seed) {
+        job_template.seed = random_seed();
+    }
+    save_settings();
+    report_begin(&report, output_format, "io-benchmark");
+    add_config(argc, argv);
+    struct io_result * total = malloc(sizeof(struct io_result));
+    for (int i = 0; i < job_file.sections_count && !status; ++i) {
+        struct job_file_section * section = &job_file.sections[i];
+        order_layout_axes(section);
+        long points = job_file_points(section);
+        for (long point = 0; point < points && !status; ++point) {
+            status = run_job_point(section, point, total);
+        }
+    }
+    report_end(&report);
+    if (output_format == OUTPUT_TEXT && matrix_count) {
+        print_matrix();
+    }
+    free(total);
+    free(samples);
+    free(matrix);
+    restore_settings();
+    if (!flag_no_clear) {
+        clear_layout();
+    }
+    job_file_free(&job_file);
+    if (!status && failed_workers) {
+        return 4;
+    }
+    if (!status && verify_errors) {
+        return 5;
+    }
+    return status;
+}
+
+// tells which options trace replay does not support; returns 0 or prints error
+int check_trace_args() {
+    if (job_template.engine != ENGINE_SYNC && job_template.engine != ENGINE_IO_URING) {
+        fprintf(stderr, "Trace replay works with sync and io_uring engines only. See help\n");
+        return 2;
+    }
+    if (job_template.runtime > 0 || job_template.rate > 0 || job_template.layout != LAYOUT_NONE || job_template.flag_verify
+        || job_template.fsync_every || job_template.fdatasync_every || job_template.flag_fixed_buffers || job_template.flag_fixed_files) {
+        fprintf(stderr, "Runtime, rate, layout, verify, fsync, fdatasync and fixed buffers or files can't be used with trace replay. See help\n");
+        return 2;
+    }
+    if (trace_speed < 0) {
+        fprintf(stderr, "Trace speed was not set properly. See help\n");
+        return 2;
+    }
+    return 0;
+}
+
+// writes every trace file up to its furthest operation; returns 0 or prints error
+int lay_out_trace(const struct trace * trace, char * const * paths) {
+    char * buf = malloc(LAYOUT_BLOCK_SIZE);
+    struct payload_stream stream;
+    payload_stream_init(&stream, &payload, ~job_template.seed);
+    uint64_t bytes = 0;
+    struct timespec start_time;
+    timespec_get(&start_time, TIME_UTC);
+    int status = 0;
+    for (int i = 0; i < trace->files_count && !status; ++i) {
+        int fd = open(paths[i], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+            fprintf(stderr, "Can't open file %s\n", paths[i]);
+            status = 1;
+            break;
+        }
+        for (uint64_t offset = 0; offset < trace->extents[i] && !status; offset += LAYOUT_BLOCK_SIZE) {
+            size_t length = trace->extents[i] - offset < LAYOUT_BLOCK_SIZE ? trace->extents[i] - offset : LAYOUT_BLOCK_SIZE;
+            payload_fill(&stream, buf, length);
+            if (pwrite(fd, buf, length, offset) != (ssize_t) length) {
+                fprintf(stderr, "Error while laying out file %s\n", paths[i]);
+                status = 1;
+            }
+            bytes += length;
+        }
+        if (!status && fdatasync(fd)) {
+            fprintf(stderr, "Can't sync file %s\n", paths[i]);
+            status = 1;
+        }
+        close(fd);
+    }
+    struct timespec end_time;
+    timespec_get(&end_time, TIME_UTC);
+    free(buf);
+    if (!status && output_format == OUTPUT_TEXT) {
+        double time = (end_time.tv_sec - start_time.tv_sec) + 1e-9 * (end_time.tv_nsec - start_time.tv_nsec);
+        printf("Laid out %d trace files, %.1f MiB in %f s\n", trace->files_count, bytes / (1024.0 * 1024), time);
+    }
+    return status;
+}
+
+// replays trace with all workers; returns exit code
+int run_trace(int argc, char * argv []) {
+    int status = check_args();
+    if (!status) {
+        status = check_trace_args();
+    }
+    if (status) {
+        return status;
+    }
+    struct trace trace;
+    if (trace_load(&trace, trace_path)
+        || (job_template.flag_direct && trace_check_alignment(&trace, trace_path, direct_io_alignment(folder_path)))) {
+        trace_free(&trace);
+        return 2;
+    }
+    if (prepare_jobs()) {
+        trace_free(&trace);
+        return 2;
+    }
+    char ** paths = malloc(trace.files_count * sizeof(char *));
+    for (int i = 0; i < trace.files_count; ++i) {
+        paths[i] = malloc(strlen(folder_path) + sizeof(TRACE_NAMES_START) + 16);
+        sprintf(paths[i], "%s/" TRACE_NAMES_START "%d.bin", folder_path, i);
+    }
+    // records are dealt round robin, so every worker follows the whole timeline
+    struct io_replay * replays = malloc(processes_count * sizeof(struct io_replay));
+    struct trace_record * records = malloc(trace.count * sizeof(struct trace_record));
+    long next = 0;
+    for (int w = 0; w < processes_count; ++w) {
+        replays[w].records = records + next;
+        replays[w].count = 0;
+        for (long i = w; i < trace.count; i += processes_count) {
+            records[next++] = trace.records[i];
+            replays[w].count++;
+        }
+        replays[w].paths = paths;
+        replays[w].files_count = trace.files_count;
+        replays[w].max_length = trace.max_length;
+        replays[w].speed = trace_speed;
+        jobs[w].replay = &replays[w];
+    }
+    report_begin(&report, output_format, "io-benchmark");
+    add_config(argc, argv);
+    struct io_result * total = malloc(sizeof(struct io_result));
+    if (lay_out_trace(&trace, paths)) {
+        status = 3;
+    } else {
+        struct cache_state state;
+        cache_state_init(&state, cache_mode);
+        for (int i = 0; i < trace.files_count; ++i) {
+            cache_prepare_file(&state, paths[i]);
+        }
+        cache_state_check(&state);
+        if (output_format == OUTPUT_TEXT) {
+            cache_state_print(&state);
+        }
+        double time = launch_tests(&run_replayer, total);
+        if (output_format == OUTPUT_TEXT) {
+            printf("Replayed in %f s\n", time);
+            print_throughput("Read", total->bytes[IO_READ], total->latency[IO_READ].count, time);
+            print_throughput("Write", total->bytes[IO_WRITE], total->latency[IO_WRITE].count, time);
+            histogram_print("Read", &total->latency[IO_READ]);
+            histogram_print("Write", &total->latency[IO_WRITE]);
+            io_result_print_replay(total, trace.count, trace_speed);
+            print_cpu(total->bytes[IO_READ] + total->bytes[IO_WRITE], total->latency[IO_READ].count + total->latency[IO_WRITE].count);
+            print_kernel(total);
+            print_steady_state();
+        }
+        add_phase("replay-read", IO_READ, time, total);
+        add_phase("replay-write", IO_WRITE, time, total);
+    }
+    report_end(&report);
+    free(total);
+    free(samples);
+    if (!flag_no_clear) {
+        for (int i = 0; i < trace.files_count; ++i) {
+            unlink(paths[i]);
+        }
+    }
+    for (int i = 0; i < trace.files_count; ++i) {
+        free(paths[i]);
+    }
+    free(paths);
+    free(records);
+    free(replays);
+    release_jobs();
+    trace_free(&trace);
+    if (!status && failed_workers) {
+        return 4;
+    }
+    return status;
+}
+
+int main(int argc, char * argv []) {
+    if (read_args(argc, argv)) {
+        return 1; // error already printed
+    }
+    // check args
+    if (flag_help) {
+        print_help();
+        return 0;
+    }
+    if (job_file_path && trace_path) {
+        fprintf(stderr, "Job file and trace can't be used together. See help\n");
+        return 2;
+    }
+    if (job_file_path) {
+        return run_job_file(argc, argv);
+    }
+    if (trace_path) {
+        return run_trace(argc, argv);
+    }
+    int status = check_args();
+    if (status) {
+        return status;
+    }
+    if (prepare_jobs()) {
+        return 2;
+    }
+    report_begin(&report, output_format, "io-benchmark");
+    add_config(argc, argv);
+    // do writing tests, then reading tests over written files
+    struct io_result * total = malloc(sizeof(struct io_result));
+    run_write_phase(total);
+    run_read_phase(total);
+    report_end(&report);
+    free(total);
+    free(samples);
     // clear
     if (!flag_no_clear) {
         if (clear()) {
             return 3; // error already printed
         }
     }
+    if (failed_workers) {
+        return 4;
+    }
+    if (verify_errors) {
+        return 5;
+    }
     return 0;
 }
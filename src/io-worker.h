@@ -0,0 +1,1590 @@
+#ifndef IO_BENCHMARK_IO_WORKER_H
+#define IO_BENCHMARK_IO_WORKER_H
+
+// Large file writer and reader shared by io-benchmark and its standalone
+// worker utilities. Requires _GNU_SOURCE to be defined before the first include.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <sys/prctl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include "uring.h"
+#include "direct-io.h"
+#include "histogram.h"
+#include "payload.h"
+#include "offsets.h"
+#include "worker-pool.h"
+#include "verify.h"
+#include "trace.h"
+
+#define MODE_SERIAL 0
+#define MODE_RANDOM 1
+
+#define ENGINE_SYNC 0
+#define ENGINE_IO_URING 1
+#define ENGINE_MMAP 2
+#define ENGINE_VECTORED 3
+
+#define DEFAULT_BLOCK_SIZE 512
+#define DEFAULT_IODEPTH 1
+#define MAX_IODEPTH 4096
+#define SYNC_MODE_NONE 0
+#define SYNC_MODE_DSYNC 1
+#define SYNC_MODE_SYNC 2
+
+#define URING_TIMER_DATA UINT64_MAX // user data of rate limiting timer
+
+#define DEFAULT_BATCH 1
+#define MAX_BATCH IOV_MAX
+#define DEFAULT_RWMIX_READ 100
+
+#define LAYOUT_NONE 0 // file is written as found, without truncation
+#define LAYOUT_PREALLOC 1 // extents allocated with fallocate before start
+#define LAYOUT_SPARSE 2 // file truncated to full size, writes fill holes
+#define LAYOUT_APPEND 3 // file truncated to zero, writes extend it
+#define LAYOUT_OVERWRITE 4 // file fully written and synced before start
+#define LAYOUT_BLOCK_SIZE (1024 * 1024) // of overwrite lay out pass
+#define MAX_VERIFY_REPORTS 10 // mismatched blocks printed per worker
+
+// part of trace replayed by one worker
+struct io_replay {
+    const struct trace_record * records; // of this worker, by time
+    long count;
+    char * const * paths; // of all trace files, indexed by file of record
+    int files_count;
+    uint32_t max_length; // of operations in whole trace
+    double speed; // of recorded timeline; 0 means as fast as possible
+};
+
+struct io_job {
+    const char * file_path;
+    const char * source_path; // NULL means generated payload
+    const struct payload * payload; // shared generated payload; NULL makes job generate own one
+    int block_size;
+    long blocks_count; // writer only; reader takes it from file size
+    int mode;
+    struct distribution distribution; // of random mode
+    int engine;
+    int iodepth;
+    int flag_fixed_buffers;
+    int flag_fixed_files;
+    int flag_sqpoll;
+    int flag_direct;
+    int batch; // blocks per call for vectored engine
+    int flag_hipri; // RWF_HIPRI for vectored engine
+    int flag_nowait; // RWF_NOWAIT for vectored engine
+    int flag_populate; // MAP_POPULATE for mmap engine
+    int madvise; // advice for mmap engine; -1 means none
+    int fsync_every; // writes between fsync calls; 0 means never
+    int fdatasync_every; // writes between fdatasync calls; 0 means never
+    int sync_mode; // O_DSYNC or O_SYNC open flag
+    int compress_percent;
+    int dedupe_percent;
+    int rwmix_read; // percent of reads in read phase; the rest are writes
+    double runtime; // seconds; 0 means one pass over blocks
+    double ramp; // seconds of IO excluded from results before runtime
+    double rate; // operations per second of this worker on fixed timeline; 0 means as fast as possible
+    int flag_rate_per_worker; // orchestrator splits rate between workers unless set
+    int layout; // of written file before writing phase
+    int flag_verify; // stamp written blocks with header and checksum and check read ones
+    uint64_t verify_seed; // seed of writer expected in read blocks; 0 accepts any
+    const struct io_replay * replay; // set for trace replay instead of file_path
+    uint64_t seed; // 0 means random one
+};
+
+#define IO_READ 0
+#define IO_WRITE 1
+#define IO_LAYOUT 2 // calls of lay out pass before writing; results only
+
+// running totals, readable by orchestrator while worker runs
+struct io_counters {
+    uint64_t ops [2];
+    uint64_t bytes [2];
+    uint64_t latency [2]; // sum in ns
+};
+
+struct io_result {
+    struct histogram latency [3]; // indexed by IO_READ, IO_WRITE and IO_LAYOUT, ramp excluded
+    uint64_t bytes [3]; // allocated or written by lay out pass for IO_LAYOUT
+    struct histogram sync_latency; // fsync or fdatasync calls, ramp excluded
+    struct io_counters live; // ramp included
+    uint64_t minor_faults;
+    uint64_t major_faults;
+    uint64_t would_block; // RWF_NOWAIT calls repeated without it
+    double elapsed; // seconds from end of ramp till last completion
+    // how late rate limited operations were issued after their intended start, ramp excluded
+    uint64_t lag_sum;
+    uint64_t lag_max;
+    double layout_time; // seconds of lay out pass, sync included
+    // verification, ramp included
+    uint64_t verify_stamped; // written blocks
+    uint64_t verify_checked; // read blocks
+    uint64_t verify_bytes;
+    uint64_t verify_ns; // spent on stamping and checking
+    uint64_t verify_errors; // read blocks which did not match
+    uint64_t verify_unwritten; // read blocks never written
+};
+
+// options shared by orchestrator and workers
+#define IO_JOB_SHORT_OPTIONS "b:rx:S:e:q:BFPdLA:n:HWY:G:O:z:D:M:T:U:R:l:V"
+#define IO_JOB_LONG_OPTIONS \
+    {"block-size", required_argument, 0, 'b'}, \
+    {"randomly", no_argument, 0, 'r'}, \
+    {"distribution", required_argument, 0, 'x'}, \
+    {"seed", required_argument, 0, 'S'}, \
+    {"engine", required_argument, 0, 'e'}, \
+    {"iodepth", required_argument, 0, 'q'}, \
+    {"fixed-buffers", no_argument, 0, 'B'}, \
+    {"fixed-files", no_argument, 0, 'F'}, \
+    {"sqpoll", no_argument, 0, 'P'}, \
+    {"direct", no_argument, 0, 'd'}, \
+    {"populate", no_argument, 0, 'L'}, \
+    {"madvise", required_argument, 0, 'A'}, \
+    {"batch", required_argument, 0, 'n'}, \
+    {"hipri", no_argument, 0, 'H'}, \
+    {"nowait", no_argument, 0, 'W'}, \
+    {"fsync-every", required_argument, 0, 'Y'}, \
+    {"fdatasync-every", required_argument, 0, 'G'}, \
+    {"sync-mode", required_argument, 0, 'O'}, \
+    {"compress", required_argument, 0, 'z'}, \
+    {"dedupe", required_argument, 0, 'D'}, \
+    {"rwmix-read", required_argument, 0, 'M'}, \
+    {"runtime", required_argument, 0, 'T'}, \
+    {"ramp", required_argument, 0, 'U'}, \
+    {"rate", required_argument, 0, 'R'}, \
+    {"layout", required_argument, 0, 'l'}, \
+    {"verify", no_argument, 0, 'V'}
+
+static inline void io_job_init(struct io_job * job) {
+    memset(job, 0, sizeof(*job));
+    job->block_size = DEFAULT_BLOCK_SIZE;
+    job->mode = MODE_SERIAL;
+    job->engine = ENGINE_SYNC;
+    job->iodepth = DEFAULT_IODEPTH;
+    job->rwmix_read = DEFAULT_RWMIX_READ;
+    job->madvise = -1;
+    job->batch = DEFAULT_BATCH;
+}
+
+// accepts seconds with optional ms, s, m or h suffix; returns negative value on error
+static inline double parse_duration(const char * s) {
+    char * end;
+    double value = strtod(s, &end);
+    if (end == s) {
+        return -1;
+    }
+    if (!strcmp(end, "ms")) {
+        return value / 1000;
+    }
+    if (!*end || !strcmp(end, "s")) {
+        return value;
+    }
+    if (!strcmp(end, "m")) {
+        return value * 60;
+    }
+    if (!strcmp(end, "h")) {
+        return value * 3600;
+    }
+    return -1;
+}
+
+// accepts bytes with optional k or m suffix; returns -1 on error
+static inline int parse_block_size(const char * s) {
+    char * end;
+    long value = strtol(s, &end, 10);
+    if (end == s) {
+        return -1;
+    }
+    if (*end == 'k' || *end == 'K') {
+        value *= 1024;
+        ++end;
+    } else if (*end == 'm' || *end == 'M') {
+        value *= 1024 * 1024;
+        ++end;
+    }
+    return *end || value > (1L << 30) ? -1 : (int) value;
+}
+
+// returns -1 on error
+static inline int parse_layout(const char * s) {
+    static const char * names [] = {"none", "prealloc", "sparse", "append", "overwrite"};
+    for (int i = 0; i < 5; ++i) {
+        if (!strcmp(s, names[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static inline const char * layout_name(int layout) {
+    static const char * names [] = {"none", "prealloc", "sparse", "append", "overwrite"};
+    return names[layout];
+}
+
+static inline int parse_engine(const char * s) {
+    if (!strcmp(s, "sync")) {
+        return ENGINE_SYNC;
+    }
+    if (!strcmp(s, "io_uring")) {
+        return ENGINE_IO_URING;
+    }
+    if (!strcmp(s, "mmap")) {
+        return ENGINE_MMAP;
+    }
+    if (!strcmp(s, "vectored")) {
+        return ENGINE_VECTORED;
+    }
+    return -1;
+}
+
+static inline int parse_sync_mode(const char * s) {
+    if (!strcmp(s, "none")) {
+        return SYNC_MODE_NONE;
+    }
+    if (!strcmp(s, "dsync")) {
+        return SYNC_MODE_DSYNC;
+    }
+    if (!strcmp(s, "sync")) {
+        return SYNC_MODE_SYNC;
+    }
+    return -1;
+}
+
+static inline const char * engine_name(int engine) {
+    static const char * names [] = {"sync", "io_uring", "mmap", "vectored"};
+    return names[engine];
+}
+
+// returns -2 for unknown advice, as -1 means none
+static inline int parse_madvise(const char * s) {
+    if (!strcmp(s, "normal")) {
+        return MADV_NORMAL;
+    }
+    if (!strcmp(s, "sequential")) {
+        return MADV_SEQUENTIAL;
+    }
+    if (!strcmp(s, "random")) {
+        return MADV_RANDOM;
+    }
+    if (!strcmp(s, "willneed")) {
+        return MADV_WILLNEED;
+    }
+    if (!strcmp(s, "hugepage")) {
+        return MADV_HUGEPAGE;
+    }
+    return -2;
+}
+
+// accepts IOPS with optional k or m ending and optional /worker ending; returns negative value on error
+static inline double parse_rate(const char * s, int * per_worker) {
+    char * end;
+    double value = strtod(s, &end);
+    if (end == s) {
+        return -1;
+    }
+    if (*end == 'k' || *end == 'K') {
+        value *= 1e3;
+        ++end;
+    } else if (*end == 'm' || *end == 'M') {
+        value *= 1e6;
+        ++end;
+    }
+    *per_worker = !strcmp(end, "/worker");
+    if (*end && !*per_worker) {
+        return -1;
+    }
+    return value;
+}
+
+// returns 1 if option is a job option
+static inline int io_job_parse_option(struct io_job * job, int opt_c, char * arg) {
+    switch (opt_c)
+    {
+    case 'b':
+        job->block_size = parse_block_size(arg);
+        break;
+    case 'r':
+        job->mode = MODE_RANDOM;
+        break;
+    case 'x':
+        job->mode = MODE_RANDOM;
+        if (parse_distribution(arg, &job->distribution)) {
+            job->distribution.type = -1;
+        }
+        break;
+    case 'S':
+        job->seed = strtoull(arg, 0, 0);
+        break;
+    case 'e':
+        job->engine = parse_engine(arg);
+        break;
+    case 'q':
+        job->iodepth = atoi(arg);
+        break;
+    case 'B':
+        job->flag_fixed_buffers = 1;
+        break;
+    case 'F':
+        job->flag_fixed_files = 1;
+        break;
+    case 'P':
+        job->flag_sqpoll = 1;
+        break;
+    case 'd':
+        job->flag_direct = 1;
+        break;
+    case 'L':
+        job->flag_populate = 1;
+        break;
+    case 'A':
+        job->madvise = parse_madvise(arg);
+        break;
+    case 'n':
+        job->batch = atoi(arg);
+        break;
+    case 'H':
+        job->flag_hipri = 1;
+        break;
+    case 'W':
+        job->flag_nowait = 1;
+        break;
+    case 'Y':
+        job->fsync_every = atoi(arg);
+        break;
+    case 'G':
+        job->fdatasync_every = atoi(arg);
+        break;
+    case 'O':
+        job->sync_mode = parse_sync_mode(arg);
+        break;
+    case 'z':
+        job->compress_percent = atoi(arg);
+        break;
+    case 'D':
+        job->dedupe_percent = atoi(arg);
+        break;
+    case 'M':
+        job->rwmix_read = atoi(arg);
+        break;
+    case 'T':
+        job->runtime = parse_duration(arg);
+        break;
+    case 'U':
+        job->ramp = parse_duration(arg);
+        break;
+    case 'R':
+        job->rate = parse_rate(arg, &job->flag_rate_per_worker);
+        break;
+    case 'l':
+        job->layout = parse_layout(arg);
+        break;
+    case 'V':
+        job->flag_verify = 1;
+        break;
+    default:
+        return 0;
+    }
+    return 1;
+}
+
+// returns 0 if job options are valid, otherwise prints error
+static inline int io_job_check(const struct io_job * job) {
+    if (job->block_size <= 0) {
+        fprintf(stderr, "Block size was not set properly. See help\n");
+        return 1;
+    }
+    if (job->distribution.type < 0) {
+        fprintf(stderr, "Distribution was not set properly. See help\n");
+        return 1;
+    }
+    if (job->engine < 0) {
+        fprintf(stderr, "Engine was not set properly. See help\n");
+        return 1;
+    }
+    if (job->batch <= 0 || job->batch > MAX_BATCH) {
+        fprintf(stderr, "Batch was not set properly. See help\n");
+        return 1;
+    }
+    if (job->fsync_every < 0 || job->fdatasync_every < 0 || (job->fsync_every && job->fdatasync_every)) {
+        fprintf(stderr, "Set either fsync or fdatasync interval. See help\n");
+        return 1;
+    }
+    if (job->sync_mode < 0) {
+        fprintf(stderr, "Sync mode was not set properly. See help\n");
+        return 1;
+    }
+    if (job->madvise == -2) {
+        fprintf(stderr, "Memory advice was not set properly. See help\n");
+        return 1;
+    }
+    if (job->engine == ENGINE_MMAP && job->flag_direct) {
+        fprintf(stderr, "Direct IO can't be used with mmap engine. See help\n");
+        return 1;
+    }
+    if (job->iodepth <= 0 || job->iodepth > MAX_IODEPTH) {
+        fprintf(stderr, "IO depth was not set properly. See help\n");
+        return 1;
+    }
+    if (job->compress_percent < 0 || job->compress_percent > 100 || job->dedupe_percent < 0 || job->dedupe_percent > 100) {
+        fprintf(stderr, "Compressibility and dedupe ratio must be percents. See help\n");
+        return 1;
+    }
+    if (job->rwmix_read < 0 || job->rwmix_read > 100) {
+        fprintf(stderr, "Read mix must be a percent. See help\n");
+        return 1;
+    }
+    if (job->runtime < 0 || job->ramp < 0) {
+        fprintf(stderr, "Runtime was not set properly. See help\n");
+        return 1;
+    }
+    if (job->rate < 0) {
+        fprintf(stderr, "Rate was not set properly. See help\n");
+        return 1;
+    }
+    if (job->layout < 0) {
+        fprintf(stderr, "Layout was not set properly. See help\n");
+        return 1;
+    }
+    if (job->layout == LAYOUT_APPEND && (job->mode != MODE_SERIAL || job->engine == ENGINE_MMAP)) {
+        fprintf(stderr, "Append layout needs serial mode and an engine other than mmap. See help\n");
+        return 1;
+    }
+    if (job->flag_verify && job->block_size < (int) sizeof(struct block_header)) {
+        fprintf(stderr, "Verification needs blocks of at least %d bytes. See help\n", (int) sizeof(struct block_header));
+        return 1;
+    }
+    return 0;
+}
+
+static inline void io_job_print_help() {
+    printf("--block-size SIZE | -b SIZE sets block size to write and read each time, in bytes or with k or m suffix. Default value is %d\n", DEFAULT_BLOCK_SIZE);
+    printf("--randomly | -r makes IO go to random blocks instead of sequential ones\n");
+    printf("--distribution DIST | -x DIST sets distribution of random blocks and implies --randomly: uniform (default), zipf[:THETA] (0 < THETA < 1, default %.2f), hotspot:IO_PERCENT/FILE_PERCENT (IO_PERCENT of IO goes to first FILE_PERCENT of file) or permutation (every block once in random order)\n", DEFAULT_ZIPF_THETA);
+    printf("--seed SEED | -S SEED sets random seed to repeat random runs. By default seed is taken from clock\n");
+    printf("--engine ENGINE | -e ENGINE sets IO engine: sync, io_uring, mmap (copies blocks from and to mapped file) or vectored (positional preadv2/pwritev2 of a few blocks per call). Default value is sync\n");
+    printf("--iodepth DEPTH | -q DEPTH sets count of requests in flight per worker for io_uring engine. Default value is %d\n", DEFAULT_IODEPTH);
+    printf("--fixed-buffers | -B registers buffers in io_uring\n");
+    printf("--fixed-files | -F registers files in io_uring\n");
+    printf("--sqpoll | -P makes io_uring kernel thread poll submission queue\n");
+    printf("--direct | -d opens files with O_DIRECT to bypass page cache. Block size must be a multiple of device logical block size\n");
+    printf("--batch COUNT | -n COUNT sets count of consecutive blocks in one call of vectored engine; latency and IOPS are counted per call. Default value is %d\n", DEFAULT_BATCH);
+    printf("--hipri | -H passes RWF_HIPRI to vectored engine to poll for completion (direct IO on polled queues only)\n");
+    printf("--nowait | -W passes RWF_NOWAIT to vectored engine; calls which would block are counted and repeated without it\n");
+    printf("--fsync-every COUNT | -Y COUNT calls fsync after every COUNT writes of each worker; its latency is reported separately\n");
+    printf("--fdatasync-every COUNT | -G COUNT calls fdatasync after every COUNT writes of each worker; its latency is reported separately\n");
+    printf("--sync-mode MODE | -O MODE opens files with extra flag: none (default), dsync (O_DSYNC) or sync (O_SYNC)\n");
+    printf("--populate | -L maps files with MAP_POPULATE for mmap engine, so pages are faulted in before start\n");
+    printf("--madvise ADVICE | -A ADVICE gives advice on mapped file for mmap engine: normal, sequential, random, willneed or hugepage\n");
+    printf("--compress PERCENT | -z PERCENT makes written data compressible: PERCENT of bytes are zeros. Default value is 0\n");
+    printf("--dedupe PERCENT | -D PERCENT makes PERCENT of written 4 KiB chunks duplicates of each other. Default value is 0\n");
+    printf("--runtime TIME | -T TIME makes every phase run for TIME (e.g. 500ms, 60s, 2m) going over file again and again instead of one pass\n");
+    printf("--ramp TIME | -U TIME runs IO for TIME before runtime without counting it in results\n");
+    printf("--rate IOPS | -R IOPS issues operations on a fixed timeline of IOPS per second (e.g. 20k) instead of as fast as possible; latency counts from intended start of each operation, so stalls are not hidden. Orchestrator splits IOPS between workers unless it ends with /worker\n");
+    printf("--layout LAYOUT | -l LAYOUT sets how written file is laid out before timed writes: prealloc (fallocate of full size), sparse (truncated to full size, writes fill holes), append (truncated to zero, writes extend it; serial mode only) or overwrite (fully written and synced, so writes replace allocated data). Lay out pass is timed and reported separately. By default existing file is written without truncation\n");
+    printf("--verify | -V stamps every written block with a header (offset, write number, seed of writer) and CRC32C of the block, and checks blocks when reading; mismatches are printed and counted, and time spent on checksums is reported. Blocks must hold at least %d bytes\n", (int) sizeof(struct block_header));
+    printf("--rwmix-read PERCENT | -M PERCENT makes reading a mix of PERCENT reads and the rest writes to the same laid out file. Default value is %d\n", DEFAULT_RWMIX_READ);
+}
+
+static inline void io_result_init(struct io_result * result) {
+    memset(result, 0, sizeof(*result));
+    histogram_init(&result->latency[IO_READ]);
+    histogram_init(&result->latency[IO_WRITE]);
+    histogram_init(&result->latency[IO_LAYOUT]);
+    histogram_init(&result->sync_latency);
+}
+
+static inline void io_result_merge(struct io_result * dst, const struct io_result * src) {
+    for (int op = IO_READ; op <= IO_LAYOUT; ++op) {
+        histogram_merge(&dst->latency[op], &src->latency[op]);
+        dst->bytes[op] += src->bytes[op];
+    }
+    histogram_merge(&dst->sync_latency, &src->sync_latency);
+    dst->minor_faults += src->minor_faults;
+    dst->major_faults += src->major_faults;
+    dst->would_block += src->would_block;
+    if (src->elapsed > dst->elapsed) {
+        dst->elapsed = src->elapsed;
+    }
+    dst->lag_sum += src->lag_sum;
+    if (src->lag_max > dst->lag_max) {
+        dst->lag_max = src->lag_max;
+    }
+    // workers lay out files in parallel
+    if (src->layout_time > dst->layout_time) {
+        dst->layout_time = src->layout_time;
+    }
+    dst->verify_stamped += src->verify_stamped;
+    dst->verify_checked += src->verify_checked;
+    dst->verify_bytes += src->verify_bytes;
+    dst->verify_ns += src->verify_ns;
+    dst->verify_errors += src->verify_errors;
+    dst->verify_unwritten += src->verify_unwritten;
+}
+
+// name of sync call made by job or NULL
+static inline const char * io_job_sync_name(const struct io_job * job) {
+    if (job->fsync_every) {
+        return "Fsync";
+    }
+    if (job->fdatasync_every) {
+        return "Fdatasync";
+    }
+    return 0;
+}
+
+static inline void io_result_print_would_block(const struct io_result * result) {
+    printf("Would block: %llu calls repeated without RWF_NOWAIT\n", (unsigned long long) result->would_block);
+}
+
+// target is total rate of merged workers
+static inline void io_result_print_rate(const struct io_result * result, double target) {
+    uint64_t ops = result->latency[IO_READ].count + result->latency[IO_WRITE].count;
+    double achieved = result->elapsed > 0 ? ops / result->elapsed : 0;
+    printf("Rate: target %.0f IOPS, achieved %.0f IOPS (%.1f%%), issued late by mean %.1f us, max %.1f us\n",
+        target, achieved, achieved / target * 100,
+        ops ? result->lag_sum / 1e3 / ops : 0, result->lag_max / 1e3);
+}
+
+static inline void io_result_print_layout(const struct io_result * result, int layout) {
+    double mib = result->bytes[IO_LAYOUT] / (1024.0 * 1024);
+    printf("Layout %s: %.1f MiB in %f s", layout_name(layout), mib, result->layout_time);
+    if (result->bytes[IO_LAYOUT] && result->layout_time > 0) {
+        printf(", %.1f MiB/s", mib / result->layout_time);
+    }
+    printf("\n");
+}
+
+// busy is seconds of workers summed; 0 leaves out share of checksum time
+static inline void io_result_print_verify(const struct io_result * result, int op, double busy) {
+    double time = result->verify_ns / 1e9;
+    if (op == IO_WRITE) {
+        printf("Verify: %llu blocks stamped", (unsigned long long) result->verify_stamped);
+    } else {
+        printf("Verify: %llu blocks checked, %llu mismatched, %llu never written", (unsigned long long) result->verify_checked,
+            (unsigned long long) result->verify_errors, (unsigned long long) result->verify_unwritten);
+        // mixed IO writes too
+        if (result->verify_stamped) {
+            printf(", %llu stamped", (unsigned long long) result->verify_stamped);
+        }
+    }
+    printf(", checksums took %.3f s", time);
+    if (time > 0) {
+        printf(" (%.2f GiB/s", result->verify_bytes / time / (1024 * 1024 * 1024));
+        if (busy > 0) {
+            printf(", %.1f%% of worker time", time / busy * 100);
+        }
+        printf(")");
+    }
+    printf("\n");
+}
+
+static inline void io_result_print_faults(const struct io_result * result) {
+    printf("Page faults: %llu major, %llu minor\n", (unsigned long long) result->major_faults, (unsigned long long) result->minor_faults);
+}
+
+// state of one running job
+struct io_run {
+    const struct io_job * job;
+    struct io_result * result;
+    int read_percent; // 0 for writer, 100 for reader, between for mixed IO
+    int fd;
+    int source_fd;
+    struct payload_stream payload;
+    long blocks_count;
+    off_t file_size;
+    long alignment;
+    struct offset_gen offsets;
+    struct rng mix_rng;
+    uint64_t now; // time of last completion
+    uint64_t measure_start; // end of ramp
+    uint64_t deadline; // 0 for one pass runs
+    uint64_t schedule_start; // timeline of rate limited runs
+    uint64_t issued; // operations issued so far
+    int writes_since_sync;
+    uint64_t generation; // of next stamped block
+};
+
+static inline off_t io_run_offset(struct io_run * run, long i) {
+    if (run->job->mode == MODE_RANDOM) {
+        return offset_gen_next(&run->offsets) * (off_t) run->job->block_size;
+    }
+    // timed runs go over file again and again
+    return (i % run->blocks_count) * (off_t) run->job->block_size;
+}
+
+// sets time limits once workers are released
+static inline void io_run_begin(struct io_run * run, uint64_t start) {
+    run->now = start;
+    run->schedule_start = start;
+    if (run->job->rate > 0) {
+        // default 50 us timer slack would make every paced operation late
+        prctl(PR_SET_TIMERSLACK, 1);
+    }
+    run->measure_start = start + (uint64_t) (run->job->ramp * 1e9);
+    if (run->job->runtime > 0) {
+        run->deadline = run->measure_start + (uint64_t) (run->job->runtime * 1e9);
+    }
+}
+
+// tells whether operation number i should be issued
+static inline int io_run_more(const struct io_run * run, long i) {
+    if (run->deadline) {
+        return run->now < run->deadline;
+    }
+    return i < run->blocks_count;
+}
+
+// intended start of next operation for rate limited runs; 0 otherwise
+static inline uint64_t io_run_due(const struct io_run * run) {
+    if (run->job->rate <= 0) {
+        return 0;
+    }
+    return run->schedule_start + (uint64_t) (run->issued * 1e9 / run->job->rate);
+}
+
+// counts operation issued now for due time; returns time its latency counts from:
+// intended start for rate limited runs, so stalls are not hidden, otherwise now
+static inline uint64_t io_run_issue(struct io_run * run, uint64_t due) {
+    uint64_t now = clock_ns();
+    run->issued++;
+    if (!due) {
+        return now;
+    }
+    if (now > due && due >= run->measure_start) {
+        uint64_t lag = now - due;
+        run->result->lag_sum += lag;
+        if (lag > run->result->lag_max) {
+            run->result->lag_max = lag;
+        }
+    }
+    return due;
+}
+
+// waits till due time (0 means now) and issues operation
+static inline uint64_t io_run_wait(struct io_run * run, uint64_t due) {
+    if (due && clock_ns() < due) {
+        struct timespec t = {due / 1000000000ull, due % 1000000000ull};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, 0) == EINTR) {
+        }
+    }
+    return io_run_issue(run, due);
+}
+
+// waits till next operation is due and issues it
+static inline uint64_t io_run_pace(struct io_run * run) {
+    return io_run_wait(run, io_run_due(run));
+}
+
+static inline void counter_add(uint64_t * counter, uint64_t value) {
+    // single writer; relaxed store keeps concurrent readers from seeing torn values
+    __atomic_store_n(counter, *counter + value, __ATOMIC_RELAXED);
+}
+
+// accounts finished operation which started at start
+static inline void io_run_record(struct io_run * run, int op, uint64_t start, uint64_t bytes) {
+    uint64_t now = clock_ns();
+    uint64_t latency = now - start;
+    struct io_result * result = run->result;
+    run->now = now;
+    counter_add(&result->live.ops[op], 1);
+    counter_add(&result->live.bytes[op], bytes);
+    counter_add(&result->live.latency[op], latency);
+    if (now >= run->measure_start) {
+        histogram_record(&result->latency[op], latency);
+        result->bytes[op] += bytes;
+    }
+}
+
+// counts finished write and syncs file when the job asks; returns 0 or error code
+static inline int io_run_written(struct io_run * run) {
+    const struct io_job * job = run->job;
+    int every = job->fsync_every ? job->fsync_every : job->fdatasync_every;
+    if (!every || ++run->writes_since_sync < every) {
+        return 0;
+    }
+    run->writes_since_sync = 0;
+    uint64_t start = clock_ns();
+    if ((job->fsync_every ? fsync(run->fd) : fdatasync(run->fd)) != 0) {
+        fprintf(stderr, "Error while syncing file %s: %s\n", job->file_path, strerror(errno));
+        return 14;
+    }
+    uint64_t now = clock_ns();
+    run->now = now;
+    if (now >= run->measure_start) {
+        histogram_record(&run->result->sync_latency, now - start);
+    }
+    return 0;
+}
+
+// returns IO_READ or IO_WRITE for the next operation
+static inline int io_run_pick_op(struct io_run * run) {
+    if (run->read_percent >= 100) {
+        return IO_READ;
+    }
+    if (run->read_percent <= 0) {
+        return IO_WRITE;
+    }
+    return (int) rng_below(&run->mix_rng, 100) < run->read_percent ? IO_READ : IO_WRITE;
+}
+
+// fills buffer with data to write at offset; returns 0 or error code
+static inline int io_run_fill(struct io_run * run, char * buf, off_t offset) {
+    const struct io_job * job = run->job;
+    if (run->source_fd == -1) {
+        payload_fill(&run->payload, buf, job->block_size);
+    } else if (read(run->source_fd, buf, job->block_size) != job->block_size) {
+        fprintf(stderr, "Error while reading source %s\n", job->source_path);
+        return 11;
+    }
+    if (job->flag_verify) {
+        uint64_t start = clock_ns();
+        verify_stamp(buf, job->block_size, offset, ++run->generation, job->seed);
+        run->result->verify_ns += clock_ns() - start;
+        run->result->verify_stamped++;
+        run->result->verify_bytes += job->block_size;
+    }
+    return 0;
+}
+
+// checks blocks read at offset when job verifies; partial tail block is skipped
+static inline void io_run_check(struct io_run * run, const char * buf, off_t offset, size_t length) {
+    const struct io_job * job = run->job;
+    if (!job->flag_verify) {
+        return;
+    }
+    struct io_result * result = run->result;
+    uint64_t start = clock_ns();
+    for (size_t done = 0; done + job->block_size <= length; done += job->block_size) {
+        struct block_header header;
+        int error = verify_check(buf + done, job->block_size, offset + done, job->verify_seed, &header);
+        result->verify_checked++;
+        result->verify_bytes += job->block_size;
+        if (error == VERIFY_UNWRITTEN) {
+            result->verify_unwritten++;
+        } else if (error) {
+            if (result->verify_errors++ < MAX_VERIFY_REPORTS) {
+                fprintf(stderr, "Block at offset %lld of file %s: %s (header offset %llu, generation %llu, seed %llu)\n",
+                    (long long) (offset + done), job->file_path, verify_error_name(error), (unsigned long long) header.offset,
+                    (unsigned long long) header.generation, (unsigned long long) header.seed);
+            }
+        }
+    }
+    result->verify_ns += clock_ns() - start;
+}
+
+// reports failed allocation of IO buffers, e.g. too large iodepth times block size; returns error code
+static inline int io_run_no_buffers(const char * target, long count, long size) {
+    fprintf(stderr, "Can't allocate %ld buffers of %ld bytes for %s\n", count, size, target);
+    return 16;
+}
+
+static inline int io_run_sync(struct io_run * run, struct worker * worker) {
+    const struct io_job * job = run->job;
+    int block_size = job->block_size;
+    char * buf = buffer_pool_alloc(1, block_size, run->alignment);
+    if (!buf) {
+        return io_run_no_buffers(job->file_path, 1, block_size);
+    }
+    io_run_begin(run, worker_start(worker));
+    int status = 0;
+    for (long i = 0; io_run_more(run, i) && !status; ++i) {
+        off_t offset = io_run_offset(run, i);
+        if (job->mode == MODE_RANDOM) {
+            lseek(run->fd, offset, SEEK_SET);
+        } else if (i > 0 && i % run->blocks_count == 0) {
+            lseek(run->fd, 0, SEEK_SET);
+        }
+        int op = io_run_pick_op(run);
+        if (op == IO_WRITE) {
+            if ((status = io_run_fill(run, buf, offset))) {
+                break;
+            }
+            uint64_t start = io_run_pace(run);
+            ssize_t written = write(run->fd, buf, block_size);
+            if (written != block_size) {
+                fprintf(stderr, "Error while writing file %s: %s\n", job->file_path, written == -1 ? strerror(errno) : "short write");
+                status = 6;
+                break;
+            }
+            io_run_record(run, IO_WRITE, start, written);
+            status = io_run_written(run);
+        } else {
+            uint64_t start = io_run_pace(run);
+            ssize_t read_bytes = read(run->fd, buf, block_size);
+            if (read_bytes == -1) {
+                fprintf(stderr, "Error while reading file %s: %s\n", job->file_path, strerror(errno));
+                status = 6;
+                break;
+            }
+            io_run_record(run, IO_READ, start, read_bytes);
+            io_run_check(run, buf, offset, read_bytes);
+        }
+    }
+    free(buf);
+    return status;
+}
+
+// lets requests still in flight after an error finish before their buffers are released
+static inline void io_uring_drain(struct uring * ring, int in_flight) {
+    while (in_flight > 0 && uring_submit_and_wait(ring, 1) >= 0) {
+        struct io_uring_cqe * cqe;
+        while ((cqe = uring_peek_cqe(ring))) {
+            if (cqe->user_data != URING_TIMER_DATA) {
+                --in_flight;
+            }
+            uring_cqe_seen(ring);
+        }
+    }
+}
+
+static inline int io_run_uring(struct io_run * run, struct worker * worker) {
+    const struct io_job * job = run->job;
+    int block_size = job->block_size;
+    int iodepth = job->iodepth;
+    struct uring ring;
+    // one more entry for the timer waking up rate limited runs
+    if (uring_init(&ring, iodepth + 1, job->flag_sqpoll ? IORING_SETUP_SQPOLL : 0)) {
+        fprintf(stderr, "Can't set up io_uring: %s\n", strerror(errno));
+        return 12;
+    }
+    // one buffer per in-flight request
+    char * bufs = buffer_pool_alloc(iodepth, block_size, run->alignment);
+    int * free_slots = malloc(iodepth * sizeof(int));
+    for (int i = 0; i < iodepth; ++i) {
+        free_slots[i] = i;
+    }
+    int free_count = iodepth;
+    uint64_t * submit_times = malloc(iodepth * sizeof(uint64_t));
+    int * slot_ops = malloc(iodepth * sizeof(int));
+    off_t * slot_offsets = malloc(iodepth * sizeof(off_t));
+    int status = 0;
+    if (!bufs) {
+        status = io_run_no_buffers(job->file_path, iodepth, block_size);
+        goto done;
+    }
+    if (job->flag_fixed_buffers) {
+        struct iovec * iovs = malloc(iodepth * sizeof(struct iovec));
+        for (int i = 0; i < iodepth; ++i) {
+            iovs[i].iov_base = bufs + (size_t) i * block_size;
+            iovs[i].iov_len = block_size;
+        }
+        int registered = uring_register_buffers(&ring, iovs, iodepth);
+        free(iovs);
+        if (registered) {
+            fprintf(stderr, "Can't register buffers: %s\n", strerror(errno));
+            status = 12;
+            goto done;
+        }
+    }
+    int target_fd = run->fd;
+    if (job->flag_fixed_files) {
+        if (uring_register_files(&ring, &run->fd, 1)) {
+            fprintf(stderr, "Can't register file %s: %s\n", job->file_path, strerror(errno));
+            status = 12;
+            goto done;
+        }
+        target_fd = 0; // index in registered files table
+    }
+    int opcodes [2];
+    opcodes[IO_READ] = job->flag_fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    opcodes[IO_WRITE] = job->flag_fixed_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    struct __kernel_timespec timer;
+    int timer_pending = 0;
+    io_run_begin(run, worker_start(worker));
+    long submitted = 0;
+    while (!status && (io_run_more(run, submitted) || free_count < iodepth)) {
+        // keep queue full
+        while (free_count > 0 && io_run_more(run, submitted)) {
+            uint64_t due = io_run_due(run);
+            if (due > clock_ns()) {
+                // wake up when next operation is due unless a completion comes first
+                if (!timer_pending) {
+                    timer.tv_sec = due / 1000000000ull;
+                    timer.tv_nsec = due % 1000000000ull;
+                    struct io_uring_sqe * sqe = uring_get_sqe(&ring);
+                    uring_prep_timeout_abs(sqe, &timer);
+                    sqe->user_data = URING_TIMER_DATA;
+                    timer_pending = 1;
+                }
+                break;
+            }
+            int slot = free_slots[--free_count];
+            char * buf = bufs + (size_t) slot * block_size;
+            int op = io_run_pick_op(run);
+            off_t offset = io_run_offset(run, submitted);
+            if (op == IO_WRITE && (status = io_run_fill(run, buf, offset))) {
+                free_slots[free_count++] = slot;
+                break;
+            }
+            struct io_uring_sqe * sqe = uring_get_sqe(&ring);
+            uring_prep_rw(sqe, opcodes[op], target_fd, buf, block_size, offset);
+            if (job->flag_fixed_buffers) {
+                sqe->buf_index = slot;
+            }
+            if (job->flag_fixed_files) {
+                sqe->flags |= IOSQE_FIXED_FILE;
+            }
+            sqe->user_data = slot;
+            slot_ops[slot] = op;
+            slot_offsets[slot] = offset;
+            submit_times[slot] = io_run_issue(run, due);
+            ++submitted;
+        }
+        if (status) {
+            break;
+        }
+        if (uring_submit_and_wait(&ring, 1) < 0) {
+            fprintf(stderr, "Error while submitting to io_uring: %s\n", strerror(errno));
+            status = 12;
+            break;
+        }
+        // reap completions
+        struct io_uring_cqe * cqe;
+        while ((cqe = uring_peek_cqe(&ring))) {
+            if (cqe->user_data == URING_TIMER_DATA) {
+                timer_pending = 0;
+                run->now = clock_ns();
+                uring_cqe_seen(&ring);
+                continue;
+            }
+            int slot = (int) cqe->user_data;
+            int op = slot_ops[slot];
+            if (cqe->res < 0 || (op == IO_WRITE && cqe->res != block_size)) {
+                fprintf(stderr, "Error while %s file %s: %s\n", op == IO_WRITE ? "writing" : "reading", job->file_path, cqe->res < 0 ? strerror(-cqe->res) : "short write");
+                status = 6;
+            } else {
+                io_run_record(run, op, submit_times[slot], cqe->res);
+                if (op == IO_WRITE && !status) {
+                    status = io_run_written(run);
+                } else if (op == IO_READ) {
+                    io_run_check(run, bufs + (size_t) slot * block_size, slot_offsets[slot], cqe->res);
+                }
+            }
+            free_slots[free_count++] = slot;
+            uring_cqe_seen(&ring);
+        }
+    }
+    io_uring_drain(&ring, iodepth - free_count);
+done:
+    uring_exit(&ring);
+    free(slot_ops);
+    free(slot_offsets);
+    free(submit_times);
+    free(free_slots);
+    free(bufs);
+    return status;
+}
+
+static inline int io_run_mmap(struct io_run * run, struct worker * worker) {
+    const struct io_job * job = run->job;
+    int block_size = job->block_size;
+    int prot = PROT_READ;
+    if (run->read_percent < 100) {
+        prot |= PROT_WRITE;
+        // stores into holes would allocate blocks during the run, unless that is measured on purpose
+        int error = job->layout == LAYOUT_SPARSE ? 0 : posix_fallocate(run->fd, 0, run->file_size);
+        if (error) {
+            fprintf(stderr, "Can't preallocate file %s: %s\n", job->file_path, strerror(error));
+            return 13;
+        }
+    }
+    char * map = mmap(0, run->file_size, prot, MAP_SHARED | (job->flag_populate ? MAP_POPULATE : 0), run->fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Can't map file %s: %s\n", job->file_path, strerror(errno));
+        return 13;
+    }
+    if (job->madvise >= 0 && madvise(map, run->file_size, job->madvise)) {
+        fprintf(stderr, "Can't advise on file %s: %s\n", job->file_path, strerror(errno));
+    }
+    char * buf = buffer_pool_alloc(1, block_size, 0);
+    if (!buf) {
+        munmap(map, run->file_size);
+        return io_run_no_buffers(job->file_path, 1, block_size);
+    }
+    struct rusage usage_start;
+    io_run_begin(run, worker_start(worker));
+    getrusage(RUSAGE_THREAD, &usage_start);
+    int status = 0;
+    for (long i = 0; io_run_more(run, i) && !status; ++i) {
+        off_t offset = io_run_offset(run, i);
+        // serial reading covers the tail block too
+        size_t length = block_size;
+        if (offset + block_size > run->file_size) {
+            length = run->file_size - offset;
+        }
+        int op = io_run_pick_op(run);
+        if (op == IO_WRITE) {
+            if ((status = io_run_fill(run, buf, offset))) {
+                break;
+            }
+            uint64_t start = io_run_pace(run);
+            memcpy(map + offset, buf, length);
+            io_run_record(run, IO_WRITE, start, length);
+            status = io_run_written(run);
+        } else {
+            uint64_t start = io_run_pace(run);
+            memcpy(buf, map + offset, length);
+            io_run_record(run, IO_READ, start, length);
+            io_run_check(run, buf, offset, length);
+        }
+    }
+    if (!status && run->read_percent < 100 && msync(map, run->file_size, MS_SYNC)) {
+        fprintf(stderr, "Can't sync file %s: %s\n", job->file_path, strerror(errno));
+        status = 13;
+    }
+    struct rusage usage_end;
+    getrusage(RUSAGE_THREAD, &usage_end);
+    run->result->minor_faults = usage_end.ru_minflt - usage_start.ru_minflt;
+    run->result->major_faults = usage_end.ru_majflt - usage_start.ru_majflt;
+    munmap(map, run->file_size);
+    free(buf);
+    return status;
+}
+
+static inline int io_run_vectored(struct io_run * run, struct worker * worker) {
+    const struct io_job * job = run->job;
+    int block_size = job->block_size;
+    int batch = job->batch;
+    char * bufs = buffer_pool_alloc(batch, block_size, run->alignment);
+    if (!bufs) {
+        return io_run_no_buffers(job->file_path, batch, block_size);
+    }
+    struct iovec * iovs = malloc(batch * sizeof(struct iovec));
+    int rw_flags = (job->flag_hipri ? RWF_HIPRI : 0) | (job->flag_nowait ? RWF_NOWAIT : 0);
+    io_run_begin(run, worker_start(worker));
+    int status = 0;
+    for (long i = 0; io_run_more(run, i) && !status; ) {
+        off_t offset;
+        if (job->mode == MODE_RANDOM) {
+            offset = offset_gen_next(&run->offsets) * batch * (off_t) block_size;
+        } else {
+            offset = io_run_offset(run, i);
+        }
+        // batch covers consecutive blocks and stops at the end of file
+        long count = run->blocks_count - offset / block_size;
+        if (count > batch) {
+            count = batch;
+        }
+        int op = io_run_pick_op(run);
+        for (long j = 0; j < count; ++j) {
+            iovs[j].iov_base = bufs + (size_t) j * block_size;
+            iovs[j].iov_len = block_size;
+            if (op == IO_WRITE && (status = io_run_fill(run, iovs[j].iov_base, offset + j * block_size))) {
+                break;
+            }
+        }
+        if (status) {
+            break;
+        }
+        uint64_t start = io_run_pace(run);
+        ssize_t done;
+        int flags = rw_flags;
+        while (1) {
+            if (op == IO_WRITE) {
+                done = pwritev2(run->fd, iovs, count, offset, flags);
+            } else {
+                done = preadv2(run->fd, iovs, count, offset, flags);
+            }
+            if (done != -1 || !(flags & RWF_NOWAIT)) {
+                break;
+            }
+            if (errno == EOPNOTSUPP) {
+                // e.g. buffered writes on some filesystems
+                fprintf(stderr, "RWF_NOWAIT is not supported for file %s; going on without it\n", job->file_path);
+                rw_flags &= ~RWF_NOWAIT;
+            } else if (errno == EAGAIN) {
+                run->result->would_block++;
+            } else {
+                break;
+            }
+            flags &= ~RWF_NOWAIT;
+        }
+        if (done == -1 || (op == IO_WRITE && done != count * block_size)) {
+            fprintf(stderr, "Error while %s file %s: %s\n", op == IO_WRITE ? "writing" : "reading", job->file_path, done == -1 ? strerror(errno) : "short write");
+            status = 6;
+            break;
+        }
+        io_run_record(run, op, start, done);
+        if (op == IO_WRITE && (status = io_run_written(run))) {
+            break;
+        }
+        for (long j = 0; op == IO_READ && j < count && j * block_size < done; ++j) {
+            io_run_check(run, iovs[j].iov_base, offset + j * block_size, done - j * block_size < block_size ? done - j * block_size : block_size);
+        }
+        i += count;
+    }
+    free(iovs);
+    free(bufs);
+    return status;
+}
+
+// prepares file of size bytes for writing as job's layout sets before start; records every call
+// and time of pass; written and allocated pages are synced and dropped from cache; payload is
+// needed by overwrite layout only; returns 0 or error code
+static inline int io_job_lay_out(const struct io_job * job, off_t size, struct payload_stream * payload, struct io_result * result) {
+    uint64_t pass_start = clock_ns();
+    int fd = open(job->file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        fprintf(stderr, "Can't open file %s\n", job->file_path);
+        return 4;
+    }
+    struct histogram * h = &result->latency[IO_LAYOUT];
+    int status = 0;
+    uint64_t start = clock_ns();
+    if (job->layout == LAYOUT_PREALLOC) {
+        if (fallocate(fd, 0, 0, size)) {
+            fprintf(stderr, "Can't preallocate file %s: %s\n", job->file_path, strerror(errno));
+            status = 13;
+        }
+        result->bytes[IO_LAYOUT] = size;
+        histogram_record(h, clock_ns() - start);
+    } else if (job->layout == LAYOUT_SPARSE) {
+        if (ftruncate(fd, size)) {
+            fprintf(stderr, "Can't resize file %s: %s\n", job->file_path, strerror(errno));
+            status = 13;
+        }
+        histogram_record(h, clock_ns() - start);
+    } else if (job->layout == LAYOUT_OVERWRITE) {
+        // whole blocks per write, so verified blocks can be stamped
+        size_t chunk = job->block_size < LAYOUT_BLOCK_SIZE ? LAYOUT_BLOCK_SIZE / job->block_size * job->block_size : job->block_size;
+        char * buf = malloc(chunk);
+        for (off_t offset = 0; offset < size && !status; offset += chunk) {
+            size_t length = size - offset < (off_t) chunk ? (size_t) (size - offset) : chunk;
+            payload_fill(payload, buf, length);
+            for (size_t done = 0; job->flag_verify && done + job->block_size <= length; done += job->block_size) {
+                verify_stamp(buf + done, job->block_size, offset + done, 0, job->seed);
+            }
+            start = clock_ns();
+            if (pwrite(fd, buf, length, offset) != (ssize_t) length) {
+                fprintf(stderr, "Error while laying out file %s\n", job->file_path);
+                status = 6;
+            }
+            histogram_record(h, clock_ns() - start);
+            result->bytes[IO_LAYOUT] += length;
+        }
+        free(buf);
+    }
+    if (!status && fdatasync(fd)) {
+        fprintf(stderr, "Can't sync file %s: %s\n", job->file_path, strerror(errno));
+        status = 7;
+    }
+    result->layout_time = (clock_ns() - pass_start) / 1e9;
+    // timed writes should not find laid out data in cache
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return status;
+}
+
+// read_percent is 0 for writing, 100 for reading, between for mixed IO on existing file;
+// worker may be NULL for standalone runs; returns 0 or error code
+static inline int io_job_run(const struct io_job * job, int read_percent, struct worker * worker, struct io_result * result) {
+    struct io_run run;
+    memset(&run, 0, sizeof(run));
+    run.job = job;
+    run.result = result;
+    run.read_percent = read_percent;
+    run.source_fd = -1;
+    rng_seed(&run.mix_rng, ~job->seed);
+    io_result_init(result);
+    if (job->flag_verify) {
+        crc32c_init();
+    }
+    int flags = O_RDWR;
+    if (read_percent == 0) {
+        // shared writable mapping needs file opened for reading too
+        flags = (job->engine == ENGINE_MMAP ? O_RDWR : O_WRONLY) | O_CREAT;
+    } else if (read_percent == 100) {
+        flags = O_RDONLY;
+    }
+    if (job->flag_direct) {
+        flags |= O_DIRECT;
+    }
+    if (job->sync_mode == SYNC_MODE_DSYNC) {
+        flags |= O_DSYNC;
+    } else if (job->sync_mode == SYNC_MODE_SYNC) {
+        flags |= O_SYNC;
+    }
+    run.fd = open(job->file_path, flags, 0644);
+    if (run.fd == -1) {
+        fprintf(stderr, "Can't open file %s\n", job->file_path);
+        return 4;
+    }
+    if (job->flag_direct) {
+        // offsets are multiples of block size, so checking block size is enough
+        run.alignment = direct_io_alignment(job->file_path);
+        if (job->block_size % run.alignment) {
+            fprintf(stderr, "Block size %d is not a multiple of direct IO alignment %ld\n", job->block_size, run.alignment);
+            close(run.fd);
+            return 3;
+        }
+    }
+    struct payload own_payload;
+    own_payload.pool = 0;
+    const struct payload * payload = 0;
+    if (read_percent < 100) {
+        if (job->source_path) {
+            run.source_fd = open(job->source_path, O_RDONLY);
+            if (run.source_fd == -1) {
+                fprintf(stderr, "Can't open source %s\n", job->source_path);
+                close(run.fd);
+                return 10;
+            }
+        } else {
+            payload = job->payload;
+            if (!payload) {
+                if (payload_init(&own_payload, job->compress_percent, job->dedupe_percent, job->seed)) {
+                    fprintf(stderr, "Can't allocate payload\n");
+                    close(run.fd);
+                    return 10;
+                }
+                payload = &own_payload;
+            }
+            payload_stream_init(&run.payload, payload, job->seed);
+        }
+    }
+    if (read_percent == 0) {
+        run.blocks_count = job->blocks_count;
+        run.file_size = run.blocks_count * (off_t) job->block_size;
+        if (job->layout != LAYOUT_NONE) {
+            // overwrite lays out generated data even with source, so blocks are not zeros a file system could skip
+            int status = 0;
+            if (!payload && job->layout == LAYOUT_OVERWRITE) {
+                if (payload_init(&own_payload, job->compress_percent, job->dedupe_percent, job->seed)) {
+                    fprintf(stderr, "Can't allocate payload\n");
+                    status = 10;
+                } else {
+                    payload = &own_payload;
+                }
+            }
+            // own stream keeps laid out data apart from data of timed writes
+            struct payload_stream layout_payload;
+            if (!status) {
+                if (payload) {
+                    payload_stream_init(&layout_payload, payload, ~job->seed);
+                }
+                status = io_job_lay_out(job, run.file_size, payload ? &layout_payload : 0, result);
+            }
+            if (status) {
+                close(run.fd);
+                if (run.source_fd != -1) {
+                    close(run.source_fd);
+                }
+                if (own_payload.pool) {
+                    payload_free(&own_payload);
+                }
+                return status;
+            }
+        }
+    } else {
+        struct stat fstat;
+        if (stat(job->file_path, &fstat) != 0) {
+            fprintf(stderr, "Can't get size of file %s\n", job->file_path);
+            close(run.fd);
+            return 5;
+        }
+        // serial reading covers the tail block too, otherwise only whole blocks are used
+        run.file_size = fstat.st_size;
+        run.blocks_count = fstat.st_size / job->block_size;
+        if (read_percent == 100 && job->mode == MODE_SERIAL && fstat.st_size % job->block_size) {
+            ++run.blocks_count;
+        }
+    }
+    if (job->mode == MODE_RANDOM && run.blocks_count > 0) {
+        // vectored batches are drawn as whole slots of consecutive blocks, so they neither overlap nor leave holes
+        long slots = run.blocks_count;
+        if (job->engine == ENGINE_VECTORED && job->batch > 1) {
+            slots = (run.blocks_count + job->batch - 1) / job->batch;
+        }
+        offset_gen_init(&run.offsets, &job->distribution, slots, job->seed);
+    }
+    int status = 0;
+    if (run.blocks_count == 0) {
+        // nothing to do; still take part in common start
+        worker_start(worker);
+    } else if (job->engine == ENGINE_IO_URING) {
+        status = io_run_uring(&run, worker);
+    } else if (job->engine == ENGINE_MMAP) {
+        status = io_run_mmap(&run, worker);
+    } else if (job->engine == ENGINE_VECTORED) {
+        status = io_run_vectored(&run, worker);
+    } else {
+        status = io_run_sync(&run, worker);
+    }
+    if (run.now > run.measure_start) {
+        result->elapsed = (run.now - run.measure_start) / 1e9;
+    }
+    close(run.fd);
+    if (run.source_fd != -1) {
+        close(run.source_fd);
+    }
+    if (own_payload.pool) {
+        payload_free(&own_payload);
+    }
+    return status;
+}
+
+static inline int io_job_write(const struct io_job * job, struct worker * worker, struct io_result * result) {
+    return io_job_run(job, 0, worker, result);
+}
+
+// pure reading unless job sets mix of reads and writes
+static inline int io_job_read(const struct io_job * job, struct worker * worker, struct io_result * result) {
+    return io_job_run(job, job->rwmix_read, worker, result);
+}
+
+// intended start of trace record; 0 when replaying as fast as possible
+static inline uint64_t io_replay_due(const struct io_run * run, const struct trace_record * record) {
+    double speed = run->job->replay->speed;
+    return speed > 0 ? run->schedule_start + (uint64_t) (record->time / speed) : 0;
+}
+
+// fills buffer with length bytes to write
+static inline int io_replay_fill(struct io_run * run, char * buf, size_t length) {
+    if (run->source_fd == -1) {
+        payload_fill(&run->payload, buf, length);
+    } else if (read(run->source_fd, buf, length) != (ssize_t) length) {
+        fprintf(stderr, "Error while reading source %s\n", run->job->source_path);
+        return 11;
+    }
+    return 0;
+}
+
+static inline int io_replay_sync(struct io_run * run, const int * fds, struct worker * worker) {
+    const struct io_replay * replay = run->job->replay;
+    char * buf = buffer_pool_alloc(1, replay->max_length, run->alignment);
+    if (!buf) {
+        return io_run_no_buffers("trace replay", 1, replay->max_length);
+    }
+    io_run_begin(run, worker_start(worker));
+    int status = 0;
+    for (long i = 0; i < replay->count && !status; ++i) {
+        const struct trace_record * record = &replay->records[i];
+        if (record->op == TRACE_OP_WRITE && (status = io_replay_fill(run, buf, record->length))) {
+            break;
+        }
+        uint64_t start = io_run_wait(run, io_replay_due(run, record));
+        ssize_t done;
+        if (record->op == TRACE_OP_WRITE) {
+            done = pwrite(fds[record->file], buf, record->length, record->offset);
+        } else {
+            done = pread(fds[record->file], buf, record->length, record->offset);
+        }
+        if (done == -1 || (record->op == TRACE_OP_WRITE && done != record->length)) {
+            fprintf(stderr, "Error while %s file %s: %s\n", record->op == TRACE_OP_WRITE ? "writing" : "reading",
+                replay->paths[record->file], done == -1 ? strerror(errno) : "short write");
+            status = 6;
+            break;
+        }
+        io_run_record(run, record->op, start, done);
+    }
+    free(buf);
+    return status;
+}
+
+static inline int io_replay_uring(struct io_run * run, const int * fds, struct worker * worker) {
+    const struct io_job * job = run->job;
+    const struct io_replay * replay = job->replay;
+    int iodepth = job->iodepth;
+    struct uring ring;
+    // one more entry for the timer waking up timed replay
+    if (uring_init(&ring, iodepth + 1, job->flag_sqpoll ? IORING_SETUP_SQPOLL : 0)) {
+        fprintf(stderr, "Can't set up io_uring: %s\n", strerror(errno));
+        return 12;
+    }
+    // direct IO needs every buffer aligned
+    size_t stride = replay->max_length;
+    if (run->alignment) {
+        stride = (stride + run->alignment - 1) / run->alignment * run->alignment;
+    }
+    char * bufs = buffer_pool_alloc(iodepth, stride, run->alignment);
+    if (!bufs) {
+        uring_exit(&ring);
+        return io_run_no_buffers("trace replay", iodepth, stride);
+    }
+    int * free_slots = malloc(iodepth * sizeof(int));
+    for (int i = 0; i < iodepth; ++i) {
+        free_slots[i] = i;
+    }
+    int free_count = iodepth;
+    uint64_t * submit_times = malloc(iodepth * sizeof(uint64_t));
+    const struct trace_record ** slot_records = malloc(iodepth * sizeof(struct trace_record *));
+    struct __kernel_timespec timer;
+    int timer_pending = 0;
+    io_run_begin(run, worker_start(worker));
+    long submitted = 0;
+    int status = 0;
+    while (!status && (submitted < replay->count || free_count < iodepth)) {
+        // issue due records while slots are free
+        while (free_count > 0 && submitted < replay->count) {
+            const struct trace_record * record = &replay->records[submitted];
+            uint64_t due = io_replay_due(run, record);
+            if (due > clock_ns()) {
+                if (!timer_pending) {
+                    timer.tv_sec = due / 1000000000ull;
+                    timer.tv_nsec = due % 1000000000ull;
+                    struct io_uring_sqe * sqe = uring_get_sqe(&ring);
+                    uring_prep_timeout_abs(sqe, &timer);
+                    sqe->user_data = URING_TIMER_DATA;
+                    timer_pending = 1;
+                }
+                break;
+            }
+            int slot = free_slots[--free_count];
+            char * buf = bufs + slot * stride;
+            if (record->op == TRACE_OP_WRITE && (status = io_replay_fill(run, buf, record->length))) {
+                free_slots[free_count++] = slot;
+                break;
+            }
+            struct io_uring_sqe * sqe = uring_get_sqe(&ring);
+            uring_prep_rw(sqe, record->op == TRACE_OP_WRITE ? IORING_OP_WRITE : IORING_OP_READ, fds[record->file], buf, record->length, record->offset);
+            sqe->user_data = slot;
+            slot_records[slot] = record;
+            submit_times[slot] = io_run_issue(run, due);
+            ++submitted;
+        }
+        if (status) {
+            break;
+        }
+        if (uring_submit_and_wait(&ring, 1) < 0) {
+            fprintf(stderr, "Error while submitting to io_uring: %s\n", strerror(errno));
+            status = 12;
+            break;
+        }
+        struct io_uring_cqe * cqe;
+        while ((cqe = uring_peek_cqe(&ring))) {
+            if (cqe->user_data == URING_TIMER_DATA) {
+                timer_pending = 0;
+                run->now = clock_ns();
+                uring_cqe_seen(&ring);
+                continue;
+            }
+            int slot = (int) cqe->user_data;
+            const struct trace_record * record = slot_records[slot];
+            if (cqe->res < 0 || (record->op == TRACE_OP_WRITE && (uint32_t) cqe->res != record->length)) {
+                fprintf(stderr, "Error while %s file %s: %s\n", record->op == TRACE_OP_WRITE ? "writing" : "reading", replay->paths[record->file], cqe->res < 0 ? strerror(-cqe->res) : "short write");
+                status = 6;
+            } else {
+                io_run_record(run, record->op, submit_times[slot], cqe->res);
+            }
+            free_slots[free_count++] = slot;
+            uring_cqe_seen(&ring);
+        }
+    }
+    io_uring_drain(&ring, iodepth - free_count);
+    uring_exit(&ring);
+    free(slot_records);
+    free(submit_times);
+    free(free_slots);
+    free(bufs);
+    return status;
+}
+
+// replays records of job's replay on laid out trace files; worker may be NULL; returns 0 or error code
+static inline int io_job_replay(const struct io_job * job, struct worker * worker, struct io_result * result) {
+    const struct io_replay * replay = job->replay;
+    struct io_run run;
+    memset(&run, 0, sizeof(run));
+    run.job = job;
+    run.result = result;
+    run.read_percent = 50;
+    run.source_fd = -1;
+    io_result_init(result);
+    int flags = O_RDWR;
+    if (job->flag_direct) {
+        flags |= O_DIRECT;
+    }
+    if (job->sync_mode == SYNC_MODE_DSYNC) {
+        flags |= O_DSYNC;
+    } else if (job->sync_mode == SYNC_MODE_SYNC) {
+        flags |= O_SYNC;
+    }
+    // worker opens only files its records go to
+    int * fds = malloc(replay->files_count * sizeof(int));
+    for (int i = 0; i < replay->files_count; ++i) {
+        fds[i] = -1;
+    }
+    int status = 0;
+    for (long i = 0; i < replay->count && !status; ++i) {
+        int file = replay->records[i].file;
+        if (fds[file] != -1) {
+            continue;
+        }
+        fds[file] = open(replay->paths[file], flags);
+        if (fds[file] == -1) {
+            fprintf(stderr, "Can't open file %s\n", replay->paths[file]);
+            status = 4;
+        } else if (job->flag_direct && !run.alignment) {
+            run.alignment = direct_io_alignment(replay->paths[file]);
+        }
+    }
+    struct payload own_payload;
+    own_payload.pool = 0;
+    if (!status && job->source_path) {
+        run.source_fd = open(job->source_path, O_RDONLY);
+        if (run.source_fd == -1) {
+            fprintf(stderr, "Can't open source %s\n", job->source_path);
+            status = 10;
+        }
+    } else if (!status) {
+        const struct payload * payload = job->payload;
+        if (!payload) {
+            if (payload_init(&own_payload, job->compress_percent, job->dedupe_percent, job->seed)) {
+                fprintf(stderr, "Can't allocate payload\n");
+                status = 10;
+            }
+            payload = &own_payload;
+        }
+        payload_stream_init(&run.payload, payload, job->seed);
+    }
+    if (!status && replay->speed > 0) {
+        // default 50 us timer slack would make every timed operation late
+        prctl(PR_SET_TIMERSLACK, 1);
+    }
+    if (!status && replay->count == 0) {
+        // nothing to do; still take part in common start
+        worker_start(worker);
+    } else if (!status && job->engine == ENGINE_IO_URING) {
+        status = io_replay_uring(&run, fds, worker);
+    } else if (!status) {
+        status = io_replay_sync(&run, fds, worker);
+    }
+    if (run.now > run.measure_start) {
+        result->elapsed = (run.now - run.measure_start) / 1e9;
+    }
+    for (int i = 0; i < replay->files_count; ++i) {
+        if (fds[i] != -1) {
+            close(fds[i]);
+        }
+    }
+    free(fds);
+    if (run.source_fd != -1) {
+        close(run.source_fd);
+    }
+    if (own_payload.pool) {
+        payload_free(&own_payload);
+    }
+    return status;
+}
+
+static inline void io_result_print_replay(const struct io_result * result, long records, double speed) {
+    uint64_t ops = result->latency[IO_READ].count + result->latency[IO_WRITE].count;
+    printf("Replay: %llu of %ld records", (unsigned long long) ops, records);
+    if (speed > 0) {
+        printf(" at %g times recorded speed, issued late by mean %.1f us, max %.1f us",
+            speed, ops ? result->lag_sum / 1e3 / ops : 0, result->lag_max / 1e3);
+    } else {
+        printf(" as fast as possible");
+    }
+    printf("\n");
+}
+
+#endif
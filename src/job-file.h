@@ -0,0 +1,185 @@
+#ifndef IO_BENCHMARK_JOB_FILE_H
+#define IO_BENCHMARK_JOB_FILE_H
+
+// Job file of named phases with sweep axes:
+//
+//     [global]
+//     folder=/mnt/test
+//     size=1G
+//
+//     [randread]
+//     randomly
+//     block-size=4k,16k,64k,1m
+//     processes=1,4,16
+//
+// Keys are long options without dashes; bare keys are flags. A value with
+// commas is a sweep axis, and a section runs every combination of its axes
+// with the first axis outermost; callers may reorder entries before running
+// (io-benchmark moves folder, size and processes to the front). Values of
+// list keys keep their commas, and any value split at | instead, e.g.
+// cpus=0-3,8|0-7 sweeps two CPU lists. Lines starting with # or ; are
+// comments.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_JOB_FILE_SECTIONS 256
+#define MAX_JOB_FILE_ENTRIES 64
+#define MAX_JOB_FILE_LINE 4096
+
+struct job_file_entry {
+    char * key;
+    char * value; // NULL for bare key
+    int values_count; // more than one makes sweep axis
+    char separator; // of axis values; 0 when value is never split
+};
+
+struct job_file_section {
+    char * name;
+    int entries_count;
+    struct job_file_entry entries [MAX_JOB_FILE_ENTRIES];
+};
+
+struct job_file {
+    struct job_file_section global; // entries outside of sections or in [global]
+    int sections_count;
+    struct job_file_section * sections;
+};
+
+static inline char * job_file_trim(char * s) {
+    while (*s == ' ' || *s == '\t') {
+        ++s;
+    }
+    size_t length = strlen(s);
+    while (length > 0 && strchr(" \t\r\n", s[length - 1])) {
+        s[--length] = 0;
+    }
+    return s;
+}
+
+// returns 0 on success, otherwise prints error
+// list_keys are NULL terminated names of keys whose values hold commas
+static inline int job_file_load(struct job_file * job_file, const char * path, const char * const * list_keys) {
+    memset(job_file, 0, sizeof(*job_file));
+    job_file->global.name = strdup("global");
+    job_file->sections = calloc(MAX_JOB_FILE_SECTIONS, sizeof(struct job_file_section));
+    FILE * file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Can't open job file %s\n", path);
+        return 1;
+    }
+    struct job_file_section * section = &job_file->global;
+    char line [MAX_JOB_FILE_LINE];
+    int line_number = 0;
+    int status = 0;
+    while (!status && fgets(line, sizeof(line), file)) {
+        ++line_number;
+        char * s = job_file_trim(line);
+        if (!*s || *s == '#' || *s == ';') {
+            continue;
+        }
+        if (*s == '[') {
+            char * end = strchr(s, ']');
+            if (!end || end == s + 1) {
+                status = 1;
+                break;
+            }
+            *end = 0;
+            if (!strcmp(s + 1, "global")) {
+                section = &job_file->global;
+                continue;
+            }
+            if (job_file->sections_count == MAX_JOB_FILE_SECTIONS) {
+                status = 1;
+                break;
+            }
+            section = &job_file->sections[job_file->sections_count++];
+            section->name = strdup(s + 1);
+            continue;
+        }
+        if (section->entries_count == MAX_JOB_FILE_ENTRIES) {
+            status = 1;
+            break;
+        }
+        struct job_file_entry * entry = &section->entries[section->entries_count++];
+        char * equals = strchr(s, '=');
+        entry->values_count = 1;
+        if (equals) {
+            *equals = 0;
+        }
+        entry->key = strdup(job_file_trim(s));
+        if (equals) {
+            entry->value = strdup(job_file_trim(equals + 1));
+            entry->separator = ',';
+            for (const char * const * k = list_keys; *k; ++k) {
+                if (!strcmp(*k, entry->key)) {
+                    entry->separator = 0;
+                }
+            }
+            if (strchr(entry->value, '|')) {
+                entry->separator = '|';
+            }
+            for (char * c = entry->value; *c && entry->separator; ++c) {
+                entry->values_count += *c == entry->separator;
+            }
+        }
+    }
+    fclose(file);
+    if (status) {
+        fprintf(stderr, "Bad line %d in job file %s\n", line_number, path);
+    } else if (!job_file->sections_count) {
+        fprintf(stderr, "Job file %s has no phases\n", path);
+        status = 1;
+    }
+    return status;
+}
+
+static inline void job_file_section_free(struct job_file_section * section) {
+    for (int i = 0; i < section->entries_count; ++i) {
+        free(section->entries[i].key);
+        free(section->entries[i].value);
+    }
+    free(section->name);
+}
+
+static inline void job_file_free(struct job_file * job_file) {
+    job_file_section_free(&job_file->global);
+    for (int i = 0; i < job_file->sections_count; ++i) {
+        job_file_section_free(&job_file->sections[i]);
+    }
+    free(job_file->sections);
+}
+
+// count of sweep points of section
+static inline long job_file_points(const struct job_file_section * section) {
+    long points = 1;
+    for (int i = 0; i < section->entries_count; ++i) {
+        points *= section->entries[i].values_count;
+    }
+    return points;
+}
+
+// copies value of entry used by sweep point into value; NULL when entry is a bare key
+static inline char * job_file_value(const struct job_file_section * section, int entry_index, long point, char * value) {
+    const struct job_file_entry * entry = &section->entries[entry_index];
+    if (!entry->value) {
+        return 0;
+    }
+    // the last axis changes fastest
+    for (int i = section->entries_count - 1; i > entry_index; --i) {
+        point /= section->entries[i].values_count;
+    }
+    int index = (int) (point % entry->values_count);
+    const char * s = entry->value;
+    for (int i = 0; i < index; ++i) {
+        s = strchr(s, entry->separator) + 1;
+    }
+    char separators [2] = {entry->separator, 0};
+    size_t length = strcspn(s, separators);
+    memcpy(value, s, length);
+    value[length] = 0;
+    return job_file_trim(value);
+}
+
+#endif
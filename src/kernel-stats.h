@@ -0,0 +1,361 @@
+#ifndef IO_BENCHMARK_KERNEL_STATS_H
+#define IO_BENCHMARK_KERNEL_STATS_H
+
+// Kernel counters sampled before and after every phase: /proc/diskstats of
+// the block device holding the folder, /proc/self/io of the benchmark and
+// /proc/vmstat. Device and vmstat counters are system wide, so other
+// activity on the host shows up in them too. Requires _GNU_SOURCE to be
+// defined before the first include (makedev).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/sysmacros.h>
+
+#define SECTOR_SIZE 512 // unit of diskstats whatever the device sector size is
+
+// fields of /proc/diskstats after device name; kernels before 4.18 lack discards and before 5.5 flushes
+#define DISK_READS 0
+#define DISK_READS_MERGED 1
+#define DISK_SECTORS_READ 2
+#define DISK_READ_MS 3
+#define DISK_WRITES 4
+#define DISK_WRITES_MERGED 5
+#define DISK_SECTORS_WRITTEN 6
+#define DISK_WRITE_MS 7
+#define DISK_IN_FLIGHT 8
+#define DISK_BUSY_MS 9
+#define DISK_QUEUE_MS 10 // time spent by all requests, so average queue depth over time
+#define DISK_FLUSHES 15
+#define DISK_FLUSH_MS 16
+#define DISK_FIELDS 17
+
+// fields of /proc/self/io
+#define PROC_RCHAR 0
+#define PROC_WCHAR 1
+#define PROC_READ_BYTES 2
+#define PROC_WRITE_BYTES 3
+#define PROC_CANCELLED_BYTES 4
+#define PROC_FIELDS 5
+
+// fields of /proc/vmstat; the last two are summed into reclaimed pages
+#define VM_PGPGIN 0 // KiB read from block devices
+#define VM_PGPGOUT 1 // KiB written to block devices
+#define VM_DIRTIED 2 // pages
+#define VM_WRITTEN 3
+#define VM_MAJOR_FAULTS 4
+#define VM_REFAULTS 5 // evicted file pages read again
+#define VM_FILE_PAGES 6 // current value
+#define VM_DIRTY 7 // current value
+#define VM_STEAL_KSWAPD 8
+#define VM_STEAL_DIRECT 9
+#define VM_FIELDS 10
+
+static const char * proc_io_names [PROC_FIELDS] = {"rchar", "wchar", "read_bytes", "write_bytes", "cancelled_write_bytes"};
+static const char * vmstat_names [VM_FIELDS] = {"pgpgin", "pgpgout", "nr_dirtied", "nr_written", "pgmajfault",
+    "workingset_refault_file", "nr_file_pages", "nr_dirty", "pgsteal_kswapd", "pgsteal_direct"};
+
+struct kernel_sample {
+    uint64_t time; // ns of monotonic clock
+    int has_disk;
+    int has_proc;
+    uint64_t disk [DISK_FIELDS];
+    uint64_t proc [PROC_FIELDS];
+    uint64_t vm [VM_FIELDS];
+};
+
+struct kernel_stats {
+    char device [64]; // empty when folder is not on a block device listed in diskstats
+    unsigned int major;
+    unsigned int minor;
+    int ended;
+    struct kernel_sample before;
+    struct kernel_sample after;
+};
+
+// changes between samples with derived values; rates are per second of wall time between samples
+struct kernel_summary {
+    const char * device; // 0 when device counters are not available
+    double elapsed;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t reads_merged;
+    uint64_t writes_merged;
+    uint64_t read_bytes;
+    uint64_t written_bytes;
+    uint64_t flushes;
+    double read_iops;
+    double write_iops;
+    double read_request_kib; // average size of request completed by device
+    double write_request_kib;
+    double read_await_ms; // average time of request from queueing till completion
+    double write_await_ms;
+    double queue_depth;
+    double utilization; // percent of time device had requests in flight
+    double read_amplification; // device bytes per logical byte; 0 without logical bytes
+    double write_amplification;
+    int has_proc; // 0 when /proc/self/io is not readable
+    uint64_t proc_read_bytes; // fetched from storage on behalf of the benchmark
+    uint64_t proc_write_bytes; // sent or dirtied for storage
+    uint64_t proc_cancelled_bytes; // dirtied and then truncated before write back
+    uint64_t proc_rchar; // passed through read syscalls
+    uint64_t proc_wchar;
+    uint64_t paged_in_kib;
+    uint64_t paged_out_kib;
+    uint64_t dirtied_pages;
+    uint64_t written_pages;
+    uint64_t major_faults;
+    uint64_t reclaimed_pages;
+    uint64_t refaults;
+    int64_t file_pages_change;
+    uint64_t dirty_pages; // after phase
+};
+
+// finds diskstats line of device; returns 0 if it is found
+static inline int kernel_find_disk(unsigned int major, unsigned int minor, char * name, size_t size) {
+    FILE * file = fopen("/proc/diskstats", "r");
+    if (!file) {
+        return -1;
+    }
+    char line [512];
+    int status = -1;
+    while (status && fgets(line, sizeof(line), file)) {
+        unsigned int ma;
+        unsigned int mi;
+        char device [64];
+        if (sscanf(line, "%u %u %63s", &ma, &mi, device) == 3 && ma == major && mi == minor) {
+            snprintf(name, size, "%s", device);
+            status = 0;
+        }
+    }
+    fclose(file);
+    return status;
+}
+
+// device of mount source holding path, for file systems with anonymous devices like btrfs; returns 0 on success
+static inline int kernel_mount_device(const char * path, unsigned int * major, unsigned int * minor) {
+    char real [PATH_MAX];
+    if (!realpath(path, real)) {
+        return -1;
+    }
+    FILE * file = fopen("/proc/self/mountinfo", "r");
+    if (!file) {
+        return -1;
+    }
+    char line [4096];
+    char source [PATH_MAX] = "";
+    size_t best = 0;
+    while (fgets(line, sizeof(line), file)) {
+        char mount_point [PATH_MAX];
+        char * separator = strstr(line, " - ");
+        char fs [64];
+        char mount_source [PATH_MAX];
+        if (!separator || sscanf(line, "%*s %*s %*s %*s %4095s", mount_point) != 1
+            || sscanf(separator + 3, "%63s %4095s", fs, mount_source) != 2) {
+            continue;
+        }
+        size_t length = strlen(mount_point);
+        int covers = !strcmp(mount_point, "/") || (!strncmp(real, mount_point, length) && (real[length] == '/' || !real[length]));
+        // later mounts over the same point hide earlier ones
+        if (covers && length >= best) {
+            best = length;
+            strcpy(source, mount_source);
+        }
+    }
+    fclose(file);
+    struct stat st;
+    if (strncmp(source, "/dev/", 5) || stat(source, &st) || !S_ISBLK(st.st_mode)) {
+        return -1;
+    }
+    *major = major(st.st_rdev);
+    *minor = minor(st.st_rdev);
+    return 0;
+}
+
+// resolves device holding folder; device counters are skipped when it is not found
+static inline void kernel_stats_init(struct kernel_stats * stats, const char * folder) {
+    memset(stats, 0, sizeof(*stats));
+    struct stat st;
+    if (stat(folder, &st)) {
+        return;
+    }
+    stats->major = major(st.st_dev);
+    stats->minor = minor(st.st_dev);
+    if (kernel_find_disk(stats->major, stats->minor, stats->device, sizeof(stats->device))
+        && (kernel_mount_device(folder, &stats->major, &stats->minor)
+        || kernel_find_disk(stats->major, stats->minor, stats->device, sizeof(stats->device)))) {
+        stats->device[0] = 0;
+    }
+}
+
+static inline void kernel_read_disk(const struct kernel_stats * stats, struct kernel_sample * sample) {
+    FILE * file = fopen("/proc/diskstats", "r");
+    if (!file) {
+        return;
+    }
+    char line [512];
+    while (!sample->has_disk && fgets(line, sizeof(line), file)) {
+        unsigned int major;
+        unsigned int minor;
+        int offset;
+        if (sscanf(line, "%u %u %*s%n", &major, &minor, &offset) != 2 || major != stats->major || minor != stats->minor) {
+            continue;
+        }
+        char * s = line + offset;
+        for (int i = 0; i < DISK_FIELDS; ++i) {
+            char * end;
+            sample->disk[i] = strtoull(s, &end, 10);
+            if (end == s) {
+                break; // older kernels have fewer fields
+            }
+            s = end;
+        }
+        sample->has_disk = 1;
+    }
+    fclose(file);
+}
+
+// reads "name value" lines of file into fields with given names
+static inline int kernel_read_fields(const char * path, const char ** names, int count, uint64_t * values) {
+    FILE * file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    char line [256];
+    while (fgets(line, sizeof(line), file)) {
+        char name [128];
+        unsigned long long value;
+        if (sscanf(line, "%127[^: ]%*[: ]%llu", name, &value) != 2) {
+            continue;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (!strcmp(name, names[i])) {
+                values[i] = value;
+                break;
+            }
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+static inline void kernel_sample(const struct kernel_stats * stats, struct kernel_sample * sample) {
+    memset(sample, 0, sizeof(*sample));
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    sample->time = now.tv_sec * 1000000000ull + now.tv_nsec;
+    if (stats->device[0]) {
+        kernel_read_disk(stats, sample);
+    }
+    sample->has_proc = !kernel_read_fields("/proc/self/io", proc_io_names, PROC_FIELDS, sample->proc);
+    kernel_read_fields("/proc/vmstat", vmstat_names, VM_FIELDS, sample->vm);
+}
+
+static inline void kernel_stats_begin(struct kernel_stats * stats) {
+    stats->ended = 0;
+    kernel_sample(stats, &stats->before);
+}
+
+// samples end of phase once; later calls till next begin keep the first end
+static inline void kernel_stats_end(struct kernel_stats * stats) {
+    if (!stats->ended) {
+        kernel_sample(stats, &stats->after);
+        stats->ended = 1;
+    }
+}
+
+static inline double kernel_ratio(double a, double b) {
+    return b > 0 ? a / b : 0;
+}
+
+// logical bytes are those the benchmark asked to read and write during phase
+static inline void kernel_stats_summarize(const struct kernel_stats * stats, uint64_t logical_read, uint64_t logical_written, struct kernel_summary * s) {
+    memset(s, 0, sizeof(*s));
+    const struct kernel_sample * a = &stats->before;
+    const struct kernel_sample * b = &stats->after;
+    s->elapsed = (b->time - a->time) / 1e9;
+    if (a->has_disk && b->has_disk) {
+        uint64_t d [DISK_FIELDS];
+        for (int i = 0; i < DISK_FIELDS; ++i) {
+            d[i] = b->disk[i] - a->disk[i];
+        }
+        s->device = stats->device;
+        s->reads = d[DISK_READS];
+        s->writes = d[DISK_WRITES];
+        s->reads_merged = d[DISK_READS_MERGED];
+        s->writes_merged = d[DISK_WRITES_MERGED];
+        s->read_bytes = d[DISK_SECTORS_READ] * SECTOR_SIZE;
+        s->written_bytes = d[DISK_SECTORS_WRITTEN] * SECTOR_SIZE;
+        s->flushes = d[DISK_FLUSHES];
+        s->read_iops = kernel_ratio(s->reads, s->elapsed);
+        s->write_iops = kernel_ratio(s->writes, s->elapsed);
+        s->read_request_kib = kernel_ratio(s->read_bytes / 1024.0, s->reads);
+        s->write_request_kib = kernel_ratio(s->written_bytes / 1024.0, s->writes);
+        s->read_await_ms = kernel_ratio(d[DISK_READ_MS], s->reads);
+        s->write_await_ms = kernel_ratio(d[DISK_WRITE_MS], s->writes);
+        s->queue_depth = kernel_ratio(d[DISK_QUEUE_MS] / 1e3, s->elapsed);
+        s->utilization = kernel_ratio(d[DISK_BUSY_MS] / 10.0, s->elapsed);
+        s->read_amplification = kernel_ratio(s->read_bytes, logical_read);
+        s->write_amplification = kernel_ratio(s->written_bytes, logical_written);
+    }
+    if (a->has_proc && b->has_proc) {
+        s->has_proc = 1;
+        s->proc_read_bytes = b->proc[PROC_READ_BYTES] - a->proc[PROC_READ_BYTES];
+        s->proc_write_bytes = b->proc[PROC_WRITE_BYTES] - a->proc[PROC_WRITE_BYTES];
+        s->proc_cancelled_bytes = b->proc[PROC_CANCELLED_BYTES] - a->proc[PROC_CANCELLED_BYTES];
+        s->proc_rchar = b->proc[PROC_RCHAR] - a->proc[PROC_RCHAR];
+        s->proc_wchar = b->proc[PROC_WCHAR] - a->proc[PROC_WCHAR];
+    }
+    s->paged_in_kib = b->vm[VM_PGPGIN] - a->vm[VM_PGPGIN];
+    s->paged_out_kib = b->vm[VM_PGPGOUT] - a->vm[VM_PGPGOUT];
+    s->dirtied_pages = b->vm[VM_DIRTIED] - a->vm[VM_DIRTIED];
+    s->written_pages = b->vm[VM_WRITTEN] - a->vm[VM_WRITTEN];
+    s->major_faults = b->vm[VM_MAJOR_FAULTS] - a->vm[VM_MAJOR_FAULTS];
+    s->refaults = b->vm[VM_REFAULTS] - a->vm[VM_REFAULTS];
+    s->reclaimed_pages = b->vm[VM_STEAL_KSWAPD] + b->vm[VM_STEAL_DIRECT] - a->vm[VM_STEAL_KSWAPD] - a->vm[VM_STEAL_DIRECT];
+    s->file_pages_change = (int64_t) (b->vm[VM_FILE_PAGES] - a->vm[VM_FILE_PAGES]);
+    s->dirty_pages = b->vm[VM_DIRTY];
+}
+
+static inline void kernel_summary_print(const struct kernel_summary * s) {
+    const double mib = 1024.0 * 1024;
+    if (s->device) {
+        // directions without requests are left out
+        printf("Device %s:", s->device);
+        if (s->reads) {
+            printf(" read %.0f IOPS, %.1f KiB per request, %.3f ms await, %.1f%% merged%s", s->read_iops, s->read_request_kib,
+                s->read_await_ms, kernel_ratio(100.0 * s->reads_merged, s->reads + s->reads_merged), s->writes ? ";" : "");
+        }
+        if (s->writes) {
+            printf(" write %.0f IOPS, %.1f KiB per request, %.3f ms await, %.1f%% merged", s->write_iops, s->write_request_kib,
+                s->write_await_ms, kernel_ratio(100.0 * s->writes_merged, s->writes + s->writes_merged));
+        }
+        printf("%s\n", s->reads || s->writes ? "" : " no requests");
+        printf("Device %s: %.1f MiB read, %.1f MiB written, %llu flushes, %.2f queue depth, %.1f%% busy",
+            s->device, s->read_bytes / mib, s->written_bytes / mib, (unsigned long long) s->flushes, s->queue_depth, s->utilization);
+        if (s->read_amplification > 0) {
+            printf(", read amplification %.3f", s->read_amplification);
+        }
+        if (s->write_amplification > 0) {
+            printf(", write amplification %.3f", s->write_amplification);
+        }
+        printf("\n");
+    }
+    if (s->has_proc) {
+        printf("Process IO: %.1f MiB read and %.1f MiB written by syscalls, %.1f MiB read from and %.1f MiB written to storage, %.1f MiB cancelled\n",
+            s->proc_rchar / mib, s->proc_wchar / mib, s->proc_read_bytes / mib, s->proc_write_bytes / mib, s->proc_cancelled_bytes / mib);
+    }
+    long page_size = sysconf(_SC_PAGESIZE);
+    printf("Page cache: %.1f MiB paged in, %.1f MiB paged out, %.1f MiB dirtied, %.1f MiB written back, %llu major faults, %.1f MiB reclaimed, %llu refaults, %+.1f MiB file pages, %.1f MiB dirty after\n",
+        s->paged_in_kib / 1024.0, s->paged_out_kib / 1024.0, s->dirtied_pages * page_size / mib, s->written_pages * page_size / mib,
+        (unsigned long long) s->major_faults, s->reclaimed_pages * page_size / mib, (unsigned long long) s->refaults,
+        s->file_pages_change * page_size / mib, s->dirty_pages * page_size / mib);
+}
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef IO_BENCHMARK_OFFSETS_H
+#define IO_BENCHMARK_OFFSETS_H
+
+// Random block picker with selectable distribution:
+// uniform, zipfian with theta (hot blocks scattered over the file),
+// hotspot (X% of IO goes to first Y% of the file) and permutation
+// (every block exactly once in random order).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "random.h"
+
+#define DIST_UNIFORM 0
+#define DIST_ZIPF 1
+#define DIST_HOTSPOT 2
+#define DIST_PERMUTATION 3
+
+#define DEFAULT_ZIPF_THETA 0.99
+#define ZIPF_EXACT_TERMS 1000
+
+struct distribution {
+    int type;
+    double theta;
+    double hot_io_percent;
+    double hot_file_percent;
+};
+
+struct offset_gen {
+    struct distribution dist;
+    uint64_t blocks_count;
+    struct rng rng;
+    // zipf
+    double zeta_n;
+    double alpha;
+    double eta;
+    double half_pow_theta;
+    // hotspot
+    uint64_t hot_blocks;
+    // permutation (also scatters zipf ranks)
+    int half_bits;
+    uint64_t half_mask;
+    uint64_t keys [4];
+    uint64_t perm_index;
+};
+
+// accepts uniform, zipf[:THETA], hotspot:IO_PERCENT/FILE_PERCENT and permutation; returns 0 on success
+static inline int parse_distribution(const char * s, struct distribution * dist) {
+    memset(dist, 0, sizeof(*dist));
+    if (!strcmp(s, "uniform")) {
+        dist->type = DIST_UNIFORM;
+        return 0;
+    }
+    if (!strcmp(s, "permutation")) {
+        dist->type = DIST_PERMUTATION;
+        return 0;
+    }
+    if (!strncmp(s, "zipf", 4)) {
+        dist->type = DIST_ZIPF;
+        dist->theta = DEFAULT_ZIPF_THETA;
+        if (s[4] == ':') {
+            dist->theta = atof(s + 5);
+        } else if (s[4]) {
+            return -1;
+        }
+        return dist->theta > 0 && dist->theta < 1 ? 0 : -1;
+    }
+    if (!strncmp(s, "hotspot:", 8)) {
+        dist->type = DIST_HOTSPOT;
+        if (sscanf(s + 8, "%lf/%lf", &dist->hot_io_percent, &dist->hot_file_percent) != 2) {
+            return -1;
+        }
+        if (dist->hot_io_percent < 0 || dist->hot_io_percent > 100 || dist->hot_file_percent <= 0 || dist->hot_file_percent > 100) {
+            return -1;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+// sum of 1/i^theta for i in 1..n; tail is approximated by Euler-Maclaurin formula
+static inline double zeta(uint64_t n, double theta) {
+    double sum = 0;
+    uint64_t exact = n < ZIPF_EXACT_TERMS ? n : ZIPF_EXACT_TERMS;
+    for (uint64_t i = 1; i <= exact; ++i) {
+        sum += pow((double) i, -theta);
+    }
+    if (n > exact) {
+        double m = exact + 1;
+        double last = n;
+        sum += (pow(last, 1 - theta) - pow(m, 1 - theta)) / (1 - theta);
+        sum += (pow(m, -theta) + pow(last, -theta)) / 2;
+    }
+    return sum;
+}
+
+// keyed bijection on [0, 2^(2*half_bits)); cycle walking keeps result below blocks count
+static inline uint64_t offset_gen_permute(const struct offset_gen * gen, uint64_t x) {
+    do {
+        uint64_t left = x >> gen->half_bits;
+        uint64_t right = x & gen->half_mask;
+        for (int round = 0; round < 4; ++round) {
+            uint64_t next = left ^ (mix64(right ^ gen->keys[round]) & gen->half_mask);
+            left = right;
+            right = next;
+        }
+        x = (left << gen->half_bits) | right;
+    } while (x >= gen->blocks_count);
+    return x;
+}
+
+static inline void offset_gen_rekey(struct offset_gen * gen) {
+    for (int i = 0; i < 4; ++i) {
+        gen->keys[i] = rng_next(&gen->rng);
+    }
+}
+
+static inline void offset_gen_init(struct offset_gen * gen, const struct distribution * dist, uint64_t blocks_count, uint64_t seed) {
+    memset(gen, 0, sizeof(*gen));
+    gen->dist = *dist;
+    gen->blocks_count = blocks_count;
+    rng_seed(&gen->rng, seed);
+    int bits = 1;
+    while (bits < 64 && (1ull << bits) < blocks_count) {
+        ++bits;
+    }
+    gen->half_bits = (bits + 1) / 2;
+    gen->half_mask = (1ull << gen->half_bits) - 1;
+    offset_gen_rekey(gen);
+    if (dist->type == DIST_ZIPF && blocks_count > 0) {
+        double theta = dist->theta;
+        gen->zeta_n = zeta(blocks_count, theta);
+        gen->alpha = 1 / (1 - theta);
+        gen->eta = (1 - pow(2.0 / blocks_count, 1 - theta)) / (1 - zeta(2, theta) / gen->zeta_n);
+        gen->half_pow_theta = 1 + pow(0.5, theta);
+    }
+    if (dist->type == DIST_HOTSPOT) {
+        gen->hot_blocks = (uint64_t) (blocks_count * dist->hot_file_percent / 100);
+        if (gen->hot_blocks == 0) {
+            gen->hot_blocks = 1;
+        }
+    }
+}
+
+// returns index of next block; blocks count must be positive
+static inline uint64_t offset_gen_next(struct offset_gen * gen) {
+    uint64_t n = gen->blocks_count;
+    switch (gen->dist.type)
+    {
+    case DIST_ZIPF: {
+        // Gray et al., "Quickly generating billion-record synthetic databases"
+        double u = rng_double(&gen->rng);
+        double uz = u * gen->zeta_n;
+        uint64_t rank;
+        if (uz < 1) {
+            rank = 0;
+        } else if (uz < gen->half_pow_theta) {
+            rank = 1;
+        } else {
+            rank = (uint64_t) (n * pow(gen->eta * u - gen->eta + 1, gen->alpha));
+        }
+        if (rank >= n) {
+            rank = n - 1;
+        }
+        return offset_gen_permute(gen, rank);
+    }
+    case DIST_HOTSPOT:
+        if (gen->hot_blocks >= n || rng_double(&gen->rng) * 100 < gen->dist.hot_io_percent) {
+            return rng_below(&gen->rng, gen->hot_blocks < n ? gen->hot_blocks : n);
+        }
+        return gen->hot_blocks + rng_below(&gen->rng, n - gen->hot_blocks);
+    case DIST_PERMUTATION:
+        if (gen->perm_index == n) {
+            // every block visited; start another random order
+            gen->perm_index = 0;
+            offset_gen_rekey(gen);
+        }
+        return offset_gen_permute(gen, gen->perm_index++);
+    default:
+        return rng_below(&gen->rng, n);
+    }
+}
+
+#endif
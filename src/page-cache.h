@@ -0,0 +1,179 @@
+#ifndef IO_BENCHMARK_PAGE_CACHE_H
+#define IO_BENCHMARK_PAGE_CACHE_H
+
+// Page cache state of benchmark files before read phases. Cold mode syncs
+// every file with fdatasync and drops its pages with POSIX_FADV_DONTNEED,
+// so no root is needed and caches of other files on the host stay intact;
+// warm mode reads files through once. Both count pages left resident with
+// mincore afterwards. Requires _GNU_SOURCE to be defined before the first
+// include (nftw).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CACHE_COLD 0
+#define CACHE_WARM 1
+#define CACHE_AS_IS 2
+
+#define CACHE_WINDOW (1L << 30) // of file mapped at once to count resident pages
+#define CACHE_READ_SIZE (1024 * 1024)
+#define CACHE_FOLDER_FDS 64 // nftw descriptors
+
+// totals over files prepared for one read phase
+struct cache_state {
+    int mode;
+    long files;
+    long failed; // files which could not be opened, synced or checked
+    uint64_t pages;
+    uint64_t resident_pages;
+};
+
+// returns -1 on error
+static inline int parse_cache_mode(const char * s) {
+    if (!strcmp(s, "cold")) {
+        return CACHE_COLD;
+    }
+    if (!strcmp(s, "warm")) {
+        return CACHE_WARM;
+    }
+    if (!strcmp(s, "as-is")) {
+        return CACHE_AS_IS;
+    }
+    return -1;
+}
+
+static inline const char * cache_mode_name(int mode) {
+    static const char * names [] = {"cold", "warm", "as-is"};
+    return names[mode];
+}
+
+static inline void cache_state_init(struct cache_state * state, int mode) {
+    memset(state, 0, sizeof(*state));
+    state->mode = mode;
+}
+
+// counts resident pages of open file of size bytes; returns 0 or -1 on error
+static inline int cache_count_resident(int fd, off_t size, uint64_t * pages, uint64_t * resident) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    unsigned char * vector = malloc(CACHE_WINDOW / page_size);
+    if (!vector) {
+        return -1;
+    }
+    int status = 0;
+    for (off_t offset = 0; offset < size && !status; offset += CACHE_WINDOW) {
+        size_t length = size - offset < CACHE_WINDOW ? size - offset : CACHE_WINDOW;
+        size_t count = (length + page_size - 1) / page_size;
+        void * map = mmap(0, length, PROT_READ, MAP_SHARED, fd, offset);
+        if (map == MAP_FAILED) {
+            status = -1;
+            break;
+        }
+        if (mincore(map, length, vector)) {
+            status = -1;
+        }
+        for (size_t i = 0; i < count && !status; ++i) {
+            *resident += vector[i] & 1;
+        }
+        *pages += count;
+        munmap(map, length);
+    }
+    free(vector);
+    return status;
+}
+
+// brings one file into state's mode and counts its resident pages
+static inline void cache_prepare_file(struct cache_state * state, const char * path) {
+    ++state->files;
+    if (state->mode == CACHE_AS_IS) {
+        return;
+    }
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st)) {
+        ++state->failed;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    int status = 0;
+    if (state->mode == CACHE_COLD) {
+        // dirty pages are not dropped, so write them back first
+        status = fdatasync(fd) || posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    } else {
+        char * buf = malloc(CACHE_READ_SIZE);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        while (buf && read(fd, buf, CACHE_READ_SIZE) > 0);
+        status = !buf;
+        free(buf);
+    }
+    if (!status && st.st_size > 0) {
+        status = cache_count_resident(fd, st.st_size, &state->pages, &state->resident_pages);
+    }
+    state->failed += status != 0;
+    close(fd);
+}
+
+// nftw has no user pointer
+static struct cache_state * cache_walk_state = 0;
+
+static inline int cache_walk_file(const char * path, const struct stat * st, int type, struct FTW * ftw) {
+    (void) st;
+    (void) ftw;
+    if (type == FTW_F) {
+        cache_prepare_file(cache_walk_state, path);
+    }
+    return 0;
+}
+
+// prepares every regular file under folder; returns 0 or -1 if folder can't be walked
+static inline int cache_prepare_folder(struct cache_state * state, const char * path) {
+    if (state->mode == CACHE_AS_IS) {
+        return 0;
+    }
+    cache_walk_state = state;
+    return nftw(path, &cache_walk_file, CACHE_FOLDER_FDS, FTW_PHYS) ? -1 : 0;
+}
+
+static inline double cache_resident_percent(const struct cache_state * state) {
+    return state->pages ? 100.0 * state->resident_pages / state->pages : 0;
+}
+
+static inline void cache_state_print(const struct cache_state * state) {
+    if (state->mode == CACHE_AS_IS) {
+        return;
+    }
+    long page_size = sysconf(_SC_PAGESIZE);
+    printf("Cache %s: %ld files, %.1f%% of %.1f MiB resident", cache_mode_name(state->mode), state->files,
+        cache_resident_percent(state), (double) state->pages * page_size / (1024 * 1024));
+    if (state->failed) {
+        printf(", %ld files failed", state->failed);
+    }
+    printf("\n");
+}
+
+// warns when files did not reach requested state, e.g. locked or mapped pages survived eviction
+static inline void cache_state_check(const struct cache_state * state) {
+    if (state->failed) {
+        fprintf(stderr, "Warning: can't set cache state of %ld files\n", state->failed);
+    }
+    if (state->mode == CACHE_COLD && state->resident_pages) {
+        fprintf(stderr, "Warning: %.1f%% of pages are still cached after eviction\n", cache_resident_percent(state));
+    }
+    if (state->mode == CACHE_WARM && state->resident_pages < state->pages) {
+        fprintf(stderr, "Warning: only %.1f%% of pages are cached after warming; files may not fit in memory\n", cache_resident_percent(state));
+    }
+}
+
+static inline void cache_print_help() {
+    printf("--cache MODE | -k MODE sets page cache state of files before reading: cold (default) syncs every file and drops its pages with posix_fadvise, no root needed; warm reads files through once to measure reads from cache; as-is leaves cache alone. Pages left resident are counted with mincore and reported\n");
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef IO_BENCHMARK_PAYLOAD_H
+#define IO_BENCHMARK_PAYLOAD_H
+
+// Generated write payload. A pool of pseudo random chunks is filled once and
+// shared read-only by all workers; each written chunk is copied from the pool
+// and stamped with a per-worker counter, so data stays unique without reading
+// /dev/urandom for every block.
+// Compressibility: every PAYLOAD_SEGMENT_SIZE bytes end with compress_percent
+// of zeros. Dedupe: dedupe_percent of chunks are copies of one common chunk.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "random.h"
+
+#define PAYLOAD_CHUNK_SIZE 4096
+#define PAYLOAD_SEGMENT_SIZE 256
+#define PAYLOAD_POOL_CHUNKS 256
+
+struct payload {
+    char * pool;
+    int compress_percent;
+    int dedupe_percent;
+};
+
+// per-worker state of payload generation
+struct payload_stream {
+    const struct payload * payload;
+    struct rng rng;
+    uint64_t id;
+    uint64_t counter;
+};
+
+static inline int payload_init(struct payload * payload, int compress_percent, int dedupe_percent, uint64_t seed) {
+    payload->compress_percent = compress_percent;
+    payload->dedupe_percent = dedupe_percent;
+    payload->pool = malloc(PAYLOAD_POOL_CHUNKS * PAYLOAD_CHUNK_SIZE);
+    if (!payload->pool) {
+        return -1;
+    }
+    struct rng rng;
+    rng_seed(&rng, seed);
+    int random_bytes = PAYLOAD_SEGMENT_SIZE * (100 - compress_percent) / 100;
+    for (size_t segment = 0; segment < PAYLOAD_POOL_CHUNKS * PAYLOAD_CHUNK_SIZE; segment += PAYLOAD_SEGMENT_SIZE) {
+        for (int i = 0; i < PAYLOAD_SEGMENT_SIZE; i += sizeof(uint64_t)) {
+            uint64_t value = rng_next(&rng);
+            memcpy(payload->pool + segment + i, &value, sizeof(value));
+        }
+        memset(payload->pool + segment + random_bytes, 0, PAYLOAD_SEGMENT_SIZE - random_bytes);
+    }
+    return 0;
+}
+
+static inline void payload_free(struct payload * payload) {
+    free(payload->pool);
+}
+
+static inline void payload_stream_init(struct payload_stream * stream, const struct payload * payload, uint64_t id) {
+    stream->payload = payload;
+    stream->id = id;
+    stream->counter = 0;
+    rng_seed(&stream->rng, id);
+}
+
+static inline void payload_fill(struct payload_stream * stream, char * buf, size_t len) {
+    const struct payload * payload = stream->payload;
+    for (size_t offset = 0; offset < len; offset += PAYLOAD_CHUNK_SIZE) {
+        size_t chunk_len = len - offset < PAYLOAD_CHUNK_SIZE ? len - offset : PAYLOAD_CHUNK_SIZE;
+        uint64_t r = rng_next(&stream->rng);
+        if ((int) (r % 100) < payload->dedupe_percent) {
+            // chunk 0 is the common duplicate and never gets stamped
+            memcpy(buf + offset, payload->pool, chunk_len);
+            continue;
+        }
+        const char * chunk = payload->pool + (1 + (r >> 32) % (PAYLOAD_POOL_CHUNKS - 1)) * PAYLOAD_CHUNK_SIZE;
+        memcpy(buf + offset, chunk, chunk_len);
+        uint64_t stamp [2] = {stream->id, stream->counter++};
+        memcpy(buf + offset, stamp, chunk_len < sizeof(stamp) ? chunk_len : sizeof(stamp));
+    }
+}
+
+#endif
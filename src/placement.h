@@ -0,0 +1,179 @@
+#ifndef IO_BENCHMARK_PLACEMENT_H
+#define IO_BENCHMARK_PLACEMENT_H
+
+// CPU and NUMA placement of worker threads. With a CPU list every worker
+// is pinned to one CPU of it, round robin; with a NUMA node alone workers
+// float over CPUs of the node. A NUMA node also binds memory of worker
+// threads to it, so buffers they allocate come from local memory.
+// Memory policy is set with raw set_mempolicy, so libnuma is not needed.
+// Requires _GNU_SOURCE to be defined before the first include.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define PLACEMENT_SHORT_OPTIONS "C:K:"
+#define PLACEMENT_LONG_OPTIONS \
+    {"cpus", required_argument, 0, 'C'}, \
+    {"numa-node", required_argument, 0, 'K'}
+
+#define MPOL_BIND 2
+#define MAX_NUMA_NODES 1024
+
+struct placement {
+    int cpus_count; // 0 means no CPU list, -1 means bad one
+    int cpus [CPU_SETSIZE];
+    int numa_node; // -1 means none
+    cpu_set_t node_cpus;
+};
+
+static inline void placement_init(struct placement * placement) {
+    memset(placement, 0, sizeof(*placement));
+    placement->numa_node = -1;
+}
+
+// accepts comma separated CPUs and ranges like 0-3,8; returns count of CPUs or -1 on error
+static inline int parse_cpu_list(const char * s, int * cpus) {
+    int count = 0;
+    while (*s && *s != '\n') {
+        char * end;
+        long first = strtol(s, &end, 10);
+        long last = first;
+        if (end == s) {
+            return -1;
+        }
+        if (*end == '-') {
+            s = end + 1;
+            last = strtol(s, &end, 10);
+            if (end == s) {
+                return -1;
+            }
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            return -1;
+        }
+        for (long cpu = first; cpu <= last && count < CPU_SETSIZE; ++cpu) {
+            cpus[count++] = (int) cpu;
+        }
+        s = end;
+        if (*s == ',') {
+            ++s;
+        } else if (*s && *s != '\n') {
+            return -1;
+        }
+    }
+    return count;
+}
+
+// returns 1 if option is a placement option
+static inline int placement_parse_option(struct placement * placement, int opt_c, char * arg) {
+    switch (opt_c)
+    {
+    case 'C':
+        placement->cpus_count = parse_cpu_list(arg, placement->cpus);
+        if (placement->cpus_count == 0) {
+            placement->cpus_count = -1;
+        }
+        break;
+    case 'K':
+        placement->numa_node = atoi(arg);
+        if (placement->numa_node < 0 || placement->numa_node >= MAX_NUMA_NODES) {
+            placement->numa_node = -2;
+        }
+        break;
+    default:
+        return 0;
+    }
+    return 1;
+}
+
+// returns 0 if CPUs and node exist and are allowed, otherwise prints error;
+// reads CPUs of NUMA node
+static inline int placement_check(struct placement * placement) {
+    if (placement->cpus_count < 0) {
+        fprintf(stderr, "CPU list was not set properly. See help\n");
+        return 1;
+    }
+    if (placement->numa_node == -2) {
+        fprintf(stderr, "NUMA node was not set properly. See help\n");
+        return 1;
+    }
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    for (int i = 0; i < placement->cpus_count; ++i) {
+        if (!CPU_ISSET(placement->cpus[i], &allowed)) {
+            fprintf(stderr, "CPU %d is not available. See help\n", placement->cpus[i]);
+            return 1;
+        }
+    }
+    if (placement->numa_node >= 0) {
+        char path [128];
+        sprintf(path, "/sys/devices/system/node/node%d/cpulist", placement->numa_node);
+        FILE * file = fopen(path, "r");
+        char line [4096] = "";
+        if (!file || !fgets(line, sizeof(line), file)) {
+            fprintf(stderr, "NUMA node %d was not found. See help\n", placement->numa_node);
+            if (file) {
+                fclose(file);
+            }
+            return 1;
+        }
+        fclose(file);
+        int * cpus = malloc(CPU_SETSIZE * sizeof(int));
+        int count = parse_cpu_list(line, cpus);
+        CPU_ZERO(&placement->node_cpus);
+        for (int i = 0; i < count; ++i) {
+            if (CPU_ISSET(cpus[i], &allowed)) {
+                CPU_SET(cpus[i], &placement->node_cpus);
+            }
+        }
+        free(cpus);
+        // memory-only node has no CPUs; workers then float over allowed ones
+        if (!CPU_COUNT(&placement->node_cpus)) {
+            placement->node_cpus = allowed;
+        }
+    }
+    return 0;
+}
+
+static inline int placement_is_set(const struct placement * placement) {
+    return placement->cpus_count > 0 || placement->numa_node >= 0;
+}
+
+// pins calling thread of worker number index; returns 0 or error code
+static inline int placement_apply(const struct placement * placement, int index) {
+    if (placement->cpus_count > 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(placement->cpus[index % placement->cpus_count], &set);
+        if (sched_setaffinity(0, sizeof(set), &set)) {
+            fprintf(stderr, "Can't pin worker %d to CPU %d\n", index, placement->cpus[index % placement->cpus_count]);
+            return 20;
+        }
+    } else if (placement->numa_node >= 0 && sched_setaffinity(0, sizeof(placement->node_cpus), &placement->node_cpus)) {
+        fprintf(stderr, "Can't pin worker %d to NUMA node %d\n", index, placement->numa_node);
+        return 20;
+    }
+    if (placement->numa_node >= 0) {
+        // kernel reads maxnode - 1 bits of mask
+        unsigned long mask [MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+        memset(mask, 0, sizeof(mask));
+        mask[placement->numa_node / (8 * sizeof(unsigned long))] |= 1ul << (placement->numa_node % (8 * sizeof(unsigned long)));
+        if (syscall(SYS_set_mempolicy, MPOL_BIND, mask, MAX_NUMA_NODES + 1)) {
+            fprintf(stderr, "Can't bind memory of worker %d to NUMA node %d\n", index, placement->numa_node);
+            return 20;
+        }
+    }
+    return 0;
+}
+
+static inline void placement_print_help() {
+    printf("--cpus LIST | -C LIST pins every worker to one CPU of LIST (e.g. 0-3,8), round robin. By default workers float\n");
+    printf("--numa-node NODE | -K NODE binds memory of workers to NUMA node NODE, so their buffers are node local; without --cpus workers also run on CPUs of NODE only\n");
+}
+
+#endif
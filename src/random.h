@@ -0,0 +1,64 @@
+#ifndef IO_BENCHMARK_RANDOM_H
+#define IO_BENCHMARK_RANDOM_H
+
+// Fast 64-bit pseudo random generator (xoshiro256**), seeded per worker.
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+struct rng {
+    uint64_t s [4];
+};
+
+static inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t splitmix64(uint64_t * state) {
+    return mix64(*state += 0x9e3779b97f4a7c15ull);
+}
+
+static inline void rng_seed(struct rng * rng, uint64_t seed) {
+    for (int i = 0; i < 4; ++i) {
+        rng->s[i] = splitmix64(&seed);
+    }
+}
+
+static inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_next(struct rng * rng) {
+    uint64_t * s = rng->s;
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+// seed that differs between processes started at the same second
+static inline uint64_t random_seed() {
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return mix64((uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec) ^ ((uint64_t) getpid() << 32);
+}
+
+// uniform value in range [0, n) without modulo bias worth noticing
+static inline uint64_t rng_below(struct rng * rng, uint64_t n) {
+    return (uint64_t) (((unsigned __int128) rng_next(rng) * n) >> 64);
+}
+
+// uniform value in range [0, 1)
+static inline double rng_double(struct rng * rng) {
+    return (rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef IO_BENCHMARK_REPORT_H
+#define IO_BENCHMARK_REPORT_H
+
+// Machine-readable results of orchestrators: JSON document or CSV table.
+// Call report_begin, report_config_* for every option, report_phase for
+// every phase and report_end. Nothing is printed in text format.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "histogram.h"
+#include "kernel-stats.h"
+
+#define OUTPUT_TEXT 0
+#define OUTPUT_JSON 1
+#define OUTPUT_CSV 2
+
+struct report {
+    int format;
+    const char * benchmark;
+    int configs_count;
+    int phases_count;
+};
+
+struct worker_report {
+    int id;
+    int status; // value returned by worker function
+    double elapsed; // seconds from common start till worker finished
+    uint64_t bytes;
+    uint64_t ops;
+    uint64_t errors;
+    double user_time; // CPU seconds
+    double sys_time;
+    const struct histogram * latency;
+};
+
+// files of one size range; used by filebomb phases
+struct size_report {
+    uint64_t min_size;
+    uint64_t max_size; // not included
+    uint64_t files;
+    uint64_t bytes;
+    uint64_t latency; // ns spent on files of range
+};
+
+struct phase_report {
+    const char * name;
+    double elapsed; // seconds used for throughput
+    uint64_t bytes;
+    uint64_t ops;
+    uint64_t errors;
+    const struct histogram * latency;
+    int workers_count;
+    const struct worker_report * workers;
+    int sizes_count; // 0 when phase has no size breakdown
+    const struct size_report * sizes;
+    const struct kernel_summary * kernel; // 0 when counters were not sampled
+};
+
+static inline int parse_output_format(const char * s) {
+    if (!strcmp(s, "text")) {
+        return OUTPUT_TEXT;
+    }
+    if (!strcmp(s, "json")) {
+        return OUTPUT_JSON;
+    }
+    if (!strcmp(s, "csv")) {
+        return OUTPUT_CSV;
+    }
+    return -1;
+}
+
+static inline void report_json_string(const char * s) {
+    putchar('"');
+    for (; *s; ++s) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            printf("\\%c", c);
+        } else if (c < 0x20) {
+            printf("\\u%04x", c);
+        } else {
+            putchar(c);
+        }
+    }
+    putchar('"');
+}
+
+static inline void report_begin(struct report * report, int format, const char * benchmark) {
+    report->format = format;
+    report->benchmark = benchmark;
+    report->configs_count = 0;
+    report->phases_count = 0;
+    if (format == OUTPUT_JSON) {
+        printf("{\n  \"benchmark\": ");
+        report_json_string(benchmark);
+        printf(",\n  \"config\": {");
+    } else if (format == OUTPUT_CSV) {
+        printf("# benchmark=%s\n", benchmark);
+    }
+}
+
+// csv gets config as comment lines above the table
+static inline void report_config_key(struct report * report, const char * key) {
+    if (report->format == OUTPUT_JSON) {
+        printf("%s\n    ", report->configs_count ? "," : "");
+        report_json_string(key);
+        printf(": ");
+    } else if (report->format == OUTPUT_CSV) {
+        printf("# %s=", key);
+    }
+    report->configs_count++;
+}
+
+static inline void report_config_string(struct report * report, const char * key, const char * value) {
+    if (report->format == OUTPUT_TEXT) {
+        return;
+    }
+    report_config_key(report, key);
+    if (report->format == OUTPUT_JSON) {
+        if (value) {
+            report_json_string(value);
+        } else {
+            printf("null");
+        }
+    } else {
+        printf("%s\n", value ? value : "");
+    }
+}
+
+static inline void report_config_number(struct report * report, const char * key, double value) {
+    if (report->format == OUTPUT_TEXT) {
+        return;
+    }
+    report_config_key(report, key);
+    printf(report->format == OUTPUT_JSON ? "%.15g" : "%.15g\n", value);
+}
+
+static inline void report_config_integer(struct report * report, const char * key, uint64_t value) {
+    if (report->format == OUTPUT_TEXT) {
+        return;
+    }
+    report_config_key(report, key);
+    printf(report->format == OUTPUT_JSON ? "%llu" : "%llu\n", (unsigned long long) value);
+}
+
+static inline void report_json_latency(const struct histogram * h) {
+    if (h->count == 0) {
+        printf("null");
+        return;
+    }
+    printf("{\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"p99.9\": %.3f, \"max\": %.3f}",
+        (double) h->sum / h->count / 1e3,
+        histogram_percentile(h, 50) / 1e3,
+        histogram_percentile(h, 99) / 1e3,
+        histogram_percentile(h, 99.9) / 1e3,
+        h->max / 1e3);
+}
+
+// CPU seconds per GiB and per million ops; 0 when nothing was done
+static inline double cpu_per_gib(double cpu, uint64_t bytes) {
+    return bytes ? cpu / (bytes / (1024.0 * 1024 * 1024)) : 0;
+}
+
+static inline double cpu_per_m_ops(double cpu, uint64_t ops) {
+    return ops ? cpu / (ops / 1e6) : 0;
+}
+
+static inline void report_csv_row(const char * phase, int worker, int status, double elapsed, uint64_t bytes, uint64_t ops, uint64_t errors, double user_time, double sys_time, const struct histogram * h) {
+    printf("%s,", phase);
+    if (worker < 0) {
+        printf("all,,");
+    } else {
+        printf("%d,%d,", worker, status);
+    }
+    printf("%llu,%.6f,%llu,%llu,%.3f,%.1f,", (unsigned long long) errors, elapsed,
+        (unsigned long long) bytes, (unsigned long long) ops,
+        elapsed > 0 ? bytes / elapsed / (1024 * 1024) : 0, elapsed > 0 ? ops / elapsed : 0);
+    if (h->count == 0) {
+        printf(",,,,,");
+    } else {
+        printf("%.3f,%.3f,%.3f,%.3f,%.3f,",
+            (double) h->sum / h->count / 1e3,
+            histogram_percentile(h, 50) / 1e3,
+            histogram_percentile(h, 99) / 1e3,
+            histogram_percentile(h, 99.9) / 1e3,
+            h->max / 1e3);
+    }
+    printf("%.6f,%.6f,%.6f,%.6f", user_time, sys_time,
+        cpu_per_gib(user_time + sys_time, bytes), cpu_per_m_ops(user_time + sys_time, ops));
+}
+
+static inline void report_json_kernel(const struct kernel_summary * k) {
+    if (k->device) {
+        printf(",\n      \"device\": {\"name\": ");
+        report_json_string(k->device);
+        printf(", \"reads\": %llu, \"writes\": %llu, \"reads_merged\": %llu, \"writes_merged\": %llu, \"read_bytes\": %llu, \"written_bytes\": %llu, \"flushes\": %llu,"
+            " \"read_iops\": %.1f, \"write_iops\": %.1f, \"read_request_kib\": %.3f, \"write_request_kib\": %.3f, \"read_await_ms\": %.3f, \"write_await_ms\": %.3f,"
+            " \"queue_depth\": %.3f, \"utilization_percent\": %.1f, \"read_amplification\": %.4f, \"write_amplification\": %.4f}",
+            (unsigned long long) k->reads, (unsigned long long) k->writes, (unsigned long long) k->reads_merged, (unsigned long long) k->writes_merged,
+            (unsigned long long) k->read_bytes, (unsigned long long) k->written_bytes, (unsigned long long) k->flushes,
+            k->read_iops, k->write_iops, k->read_request_kib, k->write_request_kib, k->read_await_ms, k->write_await_ms,
+            k->queue_depth, k->utilization, k->read_amplification, k->write_amplification);
+    }
+    if (k->has_proc) {
+        printf(",\n      \"process_io\": {\"rchar\": %llu, \"wchar\": %llu, \"read_bytes\": %llu, \"write_bytes\": %llu, \"cancelled_write_bytes\": %llu}",
+            (unsigned long long) k->proc_rchar, (unsigned long long) k->proc_wchar, (unsigned long long) k->proc_read_bytes,
+            (unsigned long long) k->proc_write_bytes, (unsigned long long) k->proc_cancelled_bytes);
+    }
+    printf(",\n      \"page_cache\": {\"paged_in_kib\": %llu, \"paged_out_kib\": %llu, \"dirtied_pages\": %llu, \"written_pages\": %llu, \"major_faults\": %llu,"
+        " \"reclaimed_pages\": %llu, \"refaults\": %llu, \"file_pages_change\": %lld, \"dirty_pages\": %llu}",
+        (unsigned long long) k->paged_in_kib, (unsigned long long) k->paged_out_kib, (unsigned long long) k->dirtied_pages,
+        (unsigned long long) k->written_pages, (unsigned long long) k->major_faults, (unsigned long long) k->reclaimed_pages,
+        (unsigned long long) k->refaults, (long long) k->file_pages_change, (unsigned long long) k->dirty_pages);
+}
+
+// device columns end phase rows; other rows leave them empty
+static inline void report_csv_kernel(const struct kernel_summary * k) {
+    if (k && k->device) {
+        printf(",%s,%.1f,%.1f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%llu,%llu,%.4f", k->device, k->read_iops, k->write_iops,
+            k->read_request_kib, k->write_request_kib, k->read_await_ms, k->write_await_ms, k->queue_depth, k->utilization,
+            (unsigned long long) k->read_bytes, (unsigned long long) k->written_bytes, k->write_amplification);
+    } else {
+        printf(",,,,,,,,,,,,");
+    }
+    if (k) {
+        printf(",%llu,%llu\n", (unsigned long long) k->paged_in_kib, (unsigned long long) k->paged_out_kib);
+    } else {
+        printf(",,\n");
+    }
+}
+
+// phase CPU time is sum over its workers
+static inline void report_phase(struct report * report, const struct phase_report * phase) {
+    double user_time = 0;
+    double sys_time = 0;
+    for (int i = 0; i < phase->workers_count; ++i) {
+        user_time += phase->workers[i].user_time;
+        sys_time += phase->workers[i].sys_time;
+    }
+    double cpu = user_time + sys_time;
+    if (report->format == OUTPUT_JSON) {
+        printf("%s\n    {\"name\": ", report->phases_count ? "," : "\n  },\n  \"phases\": [");
+        report_json_string(phase->name);
+        double time = phase->elapsed;
+        printf(", \"elapsed_s\": %.6f, \"bytes\": %llu, \"ops\": %llu, \"errors\": %llu, \"mib_per_s\": %.3f, \"iops\": %.1f, \"latency_us\": ",
+            time, (unsigned long long) phase->bytes, (unsigned long long) phase->ops, (unsigned long long) phase->errors,
+            time > 0 ? phase->bytes / time / (1024 * 1024) : 0, time > 0 ? phase->ops / time : 0);
+        report_json_latency(phase->latency);
+        printf(",\n      \"cpu_user_s\": %.6f, \"cpu_sys_s\": %.6f, \"cpu_s_per_gib\": %.6f, \"cpu_s_per_m_ops\": %.6f",
+            user_time, sys_time, cpu_per_gib(cpu, phase->bytes), cpu_per_m_ops(cpu, phase->ops));
+        printf(",\n      \"workers\": [");
+        for (int i = 0; i < phase->workers_count; ++i) {
+            const struct worker_report * w = &phase->workers[i];
+            printf("%s\n        {\"id\": %d, \"status\": %d, \"elapsed_s\": %.6f, \"bytes\": %llu, \"ops\": %llu, \"errors\": %llu, \"cpu_user_s\": %.6f, \"cpu_sys_s\": %.6f, \"latency_us\": ",
+                i ? "," : "", w->id, w->status, w->elapsed,
+                (unsigned long long) w->bytes, (unsigned long long) w->ops, (unsigned long long) w->errors,
+                w->user_time, w->sys_time);
+            report_json_latency(w->latency);
+            printf("}");
+        }
+        printf("\n      ]");
+        if (phase->sizes_count) {
+            printf(",\n      \"sizes\": [");
+            for (int i = 0; i < phase->sizes_count; ++i) {
+                const struct size_report * r = &phase->sizes[i];
+                double busy = r->latency / 1e9;
+                printf("%s\n        {\"min_bytes\": %llu, \"max_bytes\": %llu, \"files\": %llu, \"bytes\": %llu, \"busy_s\": %.6f, \"latency_mean_us\": %.3f, \"mib_per_s\": %.3f}",
+                    i ? "," : "", (unsigned long long) r->min_size, (unsigned long long) r->max_size,
+                    (unsigned long long) r->files, (unsigned long long) r->bytes, busy,
+                    r->files ? r->latency / 1e3 / r->files : 0, busy > 0 ? r->bytes / busy / (1024 * 1024) : 0);
+            }
+            printf("\n      ]");
+        }
+        if (phase->kernel) {
+            report_json_kernel(phase->kernel);
+        }
+        printf("}");
+    } else if (report->format == OUTPUT_CSV) {
+        if (!report->phases_count) {
+            printf("phase,worker,status,errors,elapsed_s,bytes,ops,mib_per_s,iops,latency_mean_us,latency_p50_us,latency_p99_us,latency_p999_us,latency_max_us,cpu_user_s,cpu_sys_s,cpu_s_per_gib,cpu_s_per_m_ops,device,dev_read_iops,dev_write_iops,dev_read_kib_per_req,dev_write_kib_per_req,dev_read_await_ms,dev_write_await_ms,dev_queue_depth,dev_busy_percent,dev_read_bytes,dev_written_bytes,write_amplification,paged_in_kib,paged_out_kib\n");
+        }
+        report_csv_row(phase->name, -1, 0, phase->elapsed, phase->bytes, phase->ops, phase->errors, user_time, sys_time, phase->latency);
+        report_csv_kernel(phase->kernel);
+        for (int i = 0; i < phase->workers_count; ++i) {
+            const struct worker_report * w = &phase->workers[i];
+            report_csv_row(phase->name, w->id, w->status, w->elapsed, w->bytes, w->ops, w->errors, w->user_time, w->sys_time, w->latency);
+            report_csv_kernel(0);
+        }
+        // size rows use time spent on files of range as elapsed
+        for (int i = 0; i < phase->sizes_count; ++i) {
+            const struct size_report * r = &phase->sizes[i];
+            double busy = r->latency / 1e9;
+            printf("%s,size:%llu-%llu,,0,%.6f,%llu,%llu,%.3f,%.1f,%.3f,,,,,,,,", phase->name,
+                (unsigned long long) r->min_size, (unsigned long long) r->max_size, busy,
+                (unsigned long long) r->bytes, (unsigned long long) r->files,
+                busy > 0 ? r->bytes / busy / (1024 * 1024) : 0, busy > 0 ? r->files / busy : 0,
+                r->files ? r->latency / 1e3 / r->files : 0);
+            report_csv_kernel(0);
+        }
+    }
+    report->phases_count++;
+}
+
+static inline void report_end(struct report * report) {
+    if (report->format == OUTPUT_JSON) {
+        printf("%s\n}\n", report->phases_count ? "\n  ]" : "\n  },\n  \"phases\": []");
+    }
+    fflush(stdout);
+}
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef IO_BENCHMARK_TRACE_H
+#define IO_BENCHMARK_TRACE_H
+
+// IO traces for replay. Text traces hold one operation per line:
+//
+//     # TIME OP FILE OFFSET LENGTH
+//     0.000125 R db/data.1 1048576 4096
+//     0.000210 W wal 8192 512
+//
+// TIME is seconds since any origin, OP is R or W (or read and write), FILE
+// is any name without spaces, OFFSET and LENGTH are bytes. Binary traces
+// start with "IOTRACE1" followed by little-endian records of
+// struct trace_binary_record; their files are named by number. Records are
+// sorted by time on load, and times are made relative to the first one.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#define TRACE_MAGIC "IOTRACE1"
+#define TRACE_OP_READ 0 // same values as IO_READ and IO_WRITE
+#define TRACE_OP_WRITE 1
+#define MAX_TRACE_LENGTH (64L * 1024 * 1024) // of one operation
+#define MAX_TRACE_FILES 65536
+
+struct trace_record {
+    uint64_t time; // ns since first record
+    uint64_t offset;
+    uint32_t length;
+    uint16_t file; // index in names of trace
+    uint8_t op;
+    long source; // line of text trace or number of binary record, for errors
+};
+
+struct trace_binary_record {
+    uint64_t time; // ns
+    uint64_t offset;
+    uint32_t length;
+    uint16_t file;
+    uint8_t op;
+    uint8_t reserved;
+};
+
+struct trace {
+    long count;
+    struct trace_record * records;
+    int files_count;
+    char ** names;
+    uint64_t * extents; // end of furthest operation of every file
+    uint32_t max_length;
+    int binary;
+    // name lookup while loading text traces
+    int * slots;
+    int slots_count;
+};
+
+static inline uint64_t trace_hash(const char * s) {
+    uint64_t h = 14695981039346656037ull;
+    for (; *s; ++s) {
+        h = (h ^ (unsigned char) *s) * 1099511628211ull;
+    }
+    return h;
+}
+
+// returns index of file name, adding it when new; -1 when there are too many files
+static inline int trace_file_index(struct trace * trace, const char * name) {
+    if (!trace->slots) {
+        trace->slots_count = 2 * MAX_TRACE_FILES;
+        trace->slots = malloc(trace->slots_count * sizeof(int));
+        memset(trace->slots, -1, trace->slots_count * sizeof(int));
+    }
+    uint64_t slot = trace_hash(name) & (trace->slots_count - 1);
+    while (trace->slots[slot] >= 0) {
+        if (!strcmp(trace->names[trace->slots[slot]], name)) {
+            return trace->slots[slot];
+        }
+        slot = (slot + 1) & (trace->slots_count - 1);
+    }
+    if (trace->files_count == MAX_TRACE_FILES) {
+        return -1;
+    }
+    trace->names[trace->files_count] = strdup(name);
+    trace->slots[slot] = trace->files_count;
+    return trace->files_count++;
+}
+
+static inline int trace_add(struct trace * trace, long * capacity, const struct trace_record * record) {
+    if (trace->count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 4096;
+        struct trace_record * records = realloc(trace->records, *capacity * sizeof(struct trace_record));
+        if (!records) {
+            return -1;
+        }
+        trace->records = records;
+    }
+    trace->records[trace->count++] = *record;
+    return 0;
+}
+
+// equal times keep order of trace, since qsort is not stable
+static inline int trace_compare(const void * a, const void * b) {
+    const struct trace_record * x = a;
+    const struct trace_record * y = b;
+    if (x->time != y->time) {
+        return x->time < y->time ? -1 : 1;
+    }
+    return x->source < y->source ? -1 : x->source > y->source;
+}
+
+static inline int trace_load_text(struct trace * trace, FILE * file, const char * path, long * capacity) {
+    char line [4096];
+    long line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        ++line_number;
+        char * s = line + strspn(line, " \t");
+        if (*s == '#' || *s == '\n' || !*s) {
+            continue;
+        }
+        double time;
+        char op [16];
+        char name [1024];
+        unsigned long long offset;
+        unsigned long long length;
+        struct trace_record record;
+        int ok = sscanf(s, "%lf %15s %1023s %llu %llu", &time, op, name, &offset, &length) == 5 && time >= 0
+            && length > 0 && length <= MAX_TRACE_LENGTH;
+        if (ok && (!strcasecmp(op, "r") || !strcasecmp(op, "read"))) {
+            record.op = TRACE_OP_READ;
+        } else if (ok && (!strcasecmp(op, "w") || !strcasecmp(op, "write"))) {
+            record.op = TRACE_OP_WRITE;
+        } else {
+            ok = 0;
+        }
+        int index = ok ? trace_file_index(trace, name) : -1;
+        if (index < 0) {
+            fprintf(stderr, "Bad line %ld in trace %s\n", line_number, path);
+            return -1;
+        }
+        record.time = (uint64_t) (time * 1e9);
+        record.offset = offset;
+        record.length = (uint32_t) length;
+        record.file = (uint16_t) index;
+        record.source = line_number;
+        if (trace_add(trace, capacity, &record)) {
+            fprintf(stderr, "Can't allocate memory for trace %s\n", path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline int trace_load_binary(struct trace * trace, FILE * file, const char * path, long * capacity) {
+    struct trace_binary_record in;
+    while (fread(&in, sizeof(in), 1, file) == 1) {
+        if (in.op > TRACE_OP_WRITE || !in.length || in.length > MAX_TRACE_LENGTH) {
+            fprintf(stderr, "Bad record %ld in trace %s\n", trace->count, path);
+            return -1;
+        }
+        char name [16];
+        sprintf(name, "%u", in.file);
+        struct trace_record record = {in.time, in.offset, in.length, (uint16_t) trace_file_index(trace, name), in.op, trace->count};
+        if (trace_add(trace, capacity, &record)) {
+            fprintf(stderr, "Can't allocate memory for trace %s\n", path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// returns 0 on success, otherwise prints error
+static inline int trace_load(struct trace * trace, const char * path) {
+    memset(trace, 0, sizeof(*trace));
+    trace->names = calloc(MAX_TRACE_FILES, sizeof(char *));
+    FILE * file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Can't open trace %s\n", path);
+        return -1;
+    }
+    char magic [8];
+    long capacity = 0;
+    int status;
+    if (fread(magic, sizeof(magic), 1, file) == 1 && !memcmp(magic, TRACE_MAGIC, sizeof(magic))) {
+        trace->binary = 1;
+        status = trace_load_binary(trace, file, path, &capacity);
+    } else {
+        rewind(file);
+        status = trace_load_text(trace, file, path, &capacity);
+    }
+    fclose(file);
+    free(trace->slots);
+    trace->slots = 0;
+    if (!status && !trace->count) {
+        fprintf(stderr, "Trace %s is empty\n", path);
+        status = -1;
+    }
+    if (status) {
+        return status;
+    }
+    // most traces are recorded in order and need no sort
+    int sorted = 1;
+    for (long i = 1; i < trace->count && sorted; ++i) {
+        sorted = trace->records[i - 1].time <= trace->records[i].time;
+    }
+    if (!sorted) {
+        qsort(trace->records, trace->count, sizeof(struct trace_record), &trace_compare);
+    }
+    uint64_t origin = trace->records[0].time;
+    trace->extents = calloc(trace->files_count, sizeof(uint64_t));
+    for (long i = 0; i < trace->count; ++i) {
+        struct trace_record * record = &trace->records[i];
+        record->time -= origin;
+        if (record->offset + record->length > trace->extents[record->file]) {
+            trace->extents[record->file] = record->offset + record->length;
+        }
+        if (record->length > trace->max_length) {
+            trace->max_length = record->length;
+        }
+    }
+    return 0;
+}
+
+// O_DIRECT needs aligned offsets and lengths; returns 0 or prints first bad record
+static inline int trace_check_alignment(const struct trace * trace, const char * path, long alignment) {
+    for (long i = 0; i < trace->count; ++i) {
+        const struct trace_record * record = &trace->records[i];
+        if (record->offset % alignment || record->length % alignment) {
+            fprintf(stderr, "%s %ld of trace %s is not aligned to %ld bytes required by direct IO\n",
+                trace->binary ? "Record" : "Line", record->source, path, alignment);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline void trace_free(struct trace * trace) {
+    for (int i = 0; i < trace->files_count; ++i) {
+        free(trace->names[i]);
+    }
+    free(trace->names);
+    free(trace->records);
+    free(trace->extents);
+}
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef IO_BENCHMARK_URING_H
+#define IO_BENCHMARK_URING_H
+
+// Minimal io_uring wrapper over raw syscalls, so utilities keep having
+// only default C dependencies (no liburing).
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+struct uring {
+    int fd;
+    unsigned setup_flags;
+    // submission queue
+    unsigned * sq_head;
+    unsigned * sq_tail;
+    unsigned * sq_mask;
+    unsigned * sq_flags;
+    unsigned * sq_array;
+    unsigned sq_entries;
+    unsigned sqe_head; // first sqe not yet published to the kernel
+    unsigned sqe_tail; // next sqe to hand out
+    struct io_uring_sqe * sqes;
+    // completion queue
+    unsigned * cq_head;
+    unsigned * cq_tail;
+    unsigned * cq_mask;
+    struct io_uring_cqe * cqes;
+    // mappings
+    void * sq_ptr;
+    size_t sq_size;
+    void * cq_ptr;
+    size_t cq_size;
+    size_t sqes_size;
+};
+
+static inline int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static inline int uring_init(struct uring * ring, unsigned entries, unsigned setup_flags) {
+    struct io_uring_params params;
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    params.flags = setup_flags;
+    if (setup_flags & IORING_SETUP_SQPOLL) {
+        params.sq_thread_idle = 1000; // ms before the poll thread sleeps
+    }
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+    ring->setup_flags = setup_flags;
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_size > ring->sq_size) {
+            ring->sq_size = ring->cq_size;
+        }
+        ring->cq_size = ring->sq_size;
+    }
+    ring->sq_ptr = mmap(0, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(0, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            munmap(ring->sq_ptr, ring->sq_size);
+            close(ring->fd);
+            return -1;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(0, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_ptr != ring->sq_ptr) {
+            munmap(ring->cq_ptr, ring->cq_size);
+        }
+        munmap(ring->sq_ptr, ring->sq_size);
+        close(ring->fd);
+        return -1;
+    }
+    char * sq = ring->sq_ptr;
+    ring->sq_head = (unsigned *) (sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_flags = (unsigned *) (sq + params.sq_off.flags);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    char * cq = ring->cq_ptr;
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return 0;
+}
+
+static inline void uring_exit(struct uring * ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_size);
+    }
+    munmap(ring->sq_ptr, ring->sq_size);
+    close(ring->fd);
+}
+
+static inline int uring_register_buffers(struct uring * ring, const struct iovec * iovs, unsigned count) {
+    return (int) syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, iovs, count);
+}
+
+static inline int uring_register_files(struct uring * ring, const int * fds, unsigned count) {
+    return (int) syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES, fds, count);
+}
+
+// returns zeroed sqe or NULL if submission queue is full
+static inline struct io_uring_sqe * uring_get_sqe(struct uring * ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sqe_tail - head >= ring->sq_entries) {
+        return NULL;
+    }
+    struct io_uring_sqe * sqe = &ring->sqes[ring->sqe_tail & *ring->sq_mask];
+    ring->sqe_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static inline void uring_prep_rw(struct io_uring_sqe * sqe, int op, int fd, void * buf, unsigned len, off_t offset) {
+    sqe->opcode = op;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long) buf;
+    sqe->len = len;
+    sqe->off = offset;
+}
+
+// timer which completes with -ETIME at CLOCK_MONOTONIC time ts
+static inline void uring_prep_timeout_abs(struct io_uring_sqe * sqe, struct __kernel_timespec * ts) {
+    uring_prep_rw(sqe, IORING_OP_TIMEOUT, -1, ts, 1, 0);
+    sqe->timeout_flags = IORING_TIMEOUT_ABS;
+}
+
+// publishes prepared sqes and waits for at least wait_nr completions
+static inline int uring_submit_and_wait(struct uring * ring, unsigned wait_nr) {
+    unsigned mask = *ring->sq_mask;
+    unsigned tail = *ring->sq_tail;
+    unsigned to_submit = ring->sqe_tail - ring->sqe_head;
+    while (ring->sqe_head != ring->sqe_tail) {
+        ring->sq_array[tail & mask] = ring->sqe_head & mask;
+        tail++;
+        ring->sqe_head++;
+    }
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+    unsigned flags = 0;
+    if (ring->setup_flags & IORING_SETUP_SQPOLL) {
+        // the kernel thread picks sqes up by itself; only wake it if it sleeps
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        } else if (wait_nr == 0) {
+            return (int) to_submit;
+        }
+    }
+    if (wait_nr > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+    int ret;
+    do {
+        ret = uring_enter(ring->fd, to_submit, wait_nr, flags);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+// returns next completion or NULL if there is nothing to reap
+static inline struct io_uring_cqe * uring_peek_cqe(struct uring * ring) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &ring->cqes[head & *ring->cq_mask];
+}
+
+static inline void uring_cqe_seen(struct uring * ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef IO_BENCHMARK_VERIFY_H
+#define IO_BENCHMARK_VERIFY_H
+
+// End-to-end verification of written blocks. Every block starts with a
+// header telling where and by whom it was written, and its CRC32C covers the
+// whole block except the checksum field, so readers catch misplaced, stale
+// and corrupted blocks alike.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "crc32c.h"
+
+#define VERIFY_MAGIC 0x3159465249564f49ull // "IOVRIFY1"
+
+#define VERIFY_OK 0
+#define VERIFY_UNWRITTEN 1 // zero header, e.g. hole left by random writes
+#define VERIFY_BAD_MAGIC 2
+#define VERIFY_BAD_OFFSET 3
+#define VERIFY_BAD_SEED 4
+#define VERIFY_BAD_CRC 5
+
+struct block_header {
+    uint64_t magic;
+    uint64_t offset; // of block in file
+    uint64_t generation; // write sequence number of writer; 0 for lay out pass
+    uint64_t seed; // of writer
+    uint32_t length; // of block
+    uint32_t crc;
+};
+
+// checksum of block with header in it, skipping checksum field
+static inline uint32_t verify_crc(const char * block, size_t length) {
+    size_t crc_at = offsetof(struct block_header, crc);
+    uint32_t crc = crc32c(0, block, crc_at);
+    return crc32c(crc, block + crc_at + sizeof(uint32_t), length - crc_at - sizeof(uint32_t));
+}
+
+static inline void verify_stamp(char * block, size_t length, uint64_t offset, uint64_t generation, uint64_t seed) {
+    struct block_header header = {VERIFY_MAGIC, offset, generation, seed, (uint32_t) length, 0};
+    memcpy(block, &header, sizeof(header));
+    header.crc = verify_crc(block, length);
+    memcpy(block + offsetof(struct block_header, crc), &header.crc, sizeof(header.crc));
+}
+
+// seed 0 accepts any writer; header receives block's header
+static inline int verify_check(const char * block, size_t length, uint64_t offset, uint64_t seed, struct block_header * header) {
+    memcpy(header, block, sizeof(*header));
+    if (header->magic != VERIFY_MAGIC) {
+        static const struct block_header zero;
+        return memcmp(header, &zero, sizeof(zero)) ? VERIFY_BAD_MAGIC : VERIFY_UNWRITTEN;
+    }
+    if (header->offset != offset || header->length != length) {
+        return VERIFY_BAD_OFFSET;
+    }
+    if (seed && header->seed != seed) {
+        return VERIFY_BAD_SEED;
+    }
+    if (header->crc != verify_crc(block, length)) {
+        return VERIFY_BAD_CRC;
+    }
+    return VERIFY_OK;
+}
+
+static inline const char * verify_error_name(int error) {
+    static const char * names [] = {"ok", "unwritten", "bad magic", "wrong offset", "wrong writer seed", "bad checksum"};
+    return names[error];
+}
+
+#endif
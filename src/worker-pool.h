@@ -0,0 +1,173 @@
+#ifndef IO_BENCHMARK_WORKER_POOL_H
+#define IO_BENCHMARK_WORKER_POOL_H
+
+// In-process worker threads released together by a start barrier.
+// Each worker prepares itself (opens files, allocates buffers), then calls
+// worker_start(); measured time begins when all workers are ready.
+// Optional monitor is called by the orchestrator thread every interval
+// while workers run. Workers with placement pin themselves before they
+// prepare, and CPU time of every worker is measured from start till finish.
+// Requires _GNU_SOURCE to be defined before the first include.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include "placement.h"
+
+struct start_barrier {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int waiting;
+    int released;
+    int finished;
+    uint64_t start_ns; // CLOCK_MONOTONIC time of release
+};
+
+struct monitor {
+    double interval; // seconds
+    void (* func) (double elapsed);
+};
+
+static inline uint64_t monotonic_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+struct worker {
+    int id;
+    int status; // value returned by worker function
+    int started;
+    uint64_t end_ns;
+    double elapsed; // seconds from common start till worker finished
+    double user_time; // CPU seconds from common start till worker finished
+    double sys_time;
+    struct rusage start_usage;
+    const struct placement * placement; // NULL lets worker float; set by orchestrator
+    pthread_t thread;
+    struct start_barrier * barrier;
+    int (* func) (struct worker *);
+};
+
+// blocks until the orchestrator releases all workers and returns common start time;
+// NULL worker means standalone run
+static inline uint64_t worker_start(struct worker * worker) {
+    if (!worker) {
+        return monotonic_ns();
+    }
+    struct start_barrier * barrier = worker->barrier;
+    if (worker->started) {
+        return barrier->start_ns;
+    }
+    worker->started = 1;
+    pthread_mutex_lock(&barrier->mutex);
+    barrier->waiting++;
+    pthread_cond_broadcast(&barrier->cond);
+    while (!barrier->released) {
+        pthread_cond_wait(&barrier->cond, &barrier->mutex);
+    }
+    pthread_mutex_unlock(&barrier->mutex);
+    getrusage(RUSAGE_THREAD, &worker->start_usage);
+    return barrier->start_ns;
+}
+
+static inline double timeval_diff(const struct timeval * end, const struct timeval * start) {
+    return (end->tv_sec - start->tv_sec) + 1e-6 * (end->tv_usec - start->tv_usec);
+}
+
+static inline void * worker_thread_main(void * arg) {
+    struct worker * worker = arg;
+    worker->status = 0;
+    if (worker->placement && placement_is_set(worker->placement)) {
+        worker->status = placement_apply(worker->placement, worker->id);
+    }
+    if (!worker->status) {
+        worker->status = worker->func(worker);
+    }
+    // worker failed before start; still count it as arrived
+    worker_start(worker);
+    worker->end_ns = monotonic_ns();
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    worker->user_time = timeval_diff(&usage.ru_utime, &worker->start_usage.ru_utime);
+    worker->sys_time = timeval_diff(&usage.ru_stime, &worker->start_usage.ru_stime);
+    pthread_mutex_lock(&worker->barrier->mutex);
+    worker->barrier->finished++;
+    pthread_cond_broadcast(&worker->barrier->cond);
+    pthread_mutex_unlock(&worker->barrier->mutex);
+    return 0;
+}
+
+// runs func in count threads; returns seconds from common start till the last worker finishes;
+// monitor may be NULL
+static inline double run_workers(struct worker * workers, int count, int (* func) (struct worker *), const struct monitor * monitor) {
+    struct start_barrier barrier;
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&barrier.mutex, 0);
+    pthread_cond_init(&barrier.cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    barrier.waiting = 0;
+    barrier.released = 0;
+    barrier.finished = 0;
+    int launched = 0;
+    for (int i = 0; i < count; ++i) {
+        workers[i].id = i;
+        workers[i].started = 0;
+        workers[i].barrier = &barrier;
+        workers[i].func = func;
+        if (pthread_create(&workers[i].thread, 0, &worker_thread_main, &workers[i])) {
+            fprintf(stderr, "Launch of test %d failed\n", i);
+            workers[i].status = -1;
+            workers[i].started = -1; // never joined
+            continue;
+        }
+        ++launched;
+    }
+    // wait for all workers to get ready and release them at once
+    pthread_mutex_lock(&barrier.mutex);
+    while (barrier.waiting < launched) {
+        pthread_cond_wait(&barrier.cond, &barrier.mutex);
+    }
+    barrier.start_ns = monotonic_ns();
+    barrier.released = 1;
+    pthread_cond_broadcast(&barrier.cond);
+    // wait for workers to finish, calling monitor on every interval
+    uint64_t interval_ns = monitor ? (uint64_t) (monitor->interval * 1e9) : 0;
+    uint64_t next_ns = barrier.start_ns + interval_ns;
+    while (barrier.finished < launched) {
+        if (!interval_ns) {
+            pthread_cond_wait(&barrier.cond, &barrier.mutex);
+            continue;
+        }
+        struct timespec deadline = {next_ns / 1000000000ull, next_ns % 1000000000ull};
+        if (pthread_cond_timedwait(&barrier.cond, &barrier.mutex, &deadline) == ETIMEDOUT && barrier.finished < launched) {
+            pthread_mutex_unlock(&barrier.mutex);
+            monitor->func((next_ns - barrier.start_ns) / 1e9);
+            pthread_mutex_lock(&barrier.mutex);
+            next_ns += interval_ns;
+        }
+    }
+    pthread_mutex_unlock(&barrier.mutex);
+    for (int i = 0; i < count; ++i) {
+        if (workers[i].started != -1) {
+            pthread_join(workers[i].thread, 0);
+            workers[i].elapsed = (workers[i].end_ns - barrier.start_ns) / 1e9;
+        } else {
+            workers[i].elapsed = 0;
+            workers[i].user_time = 0;
+            workers[i].sys_time = 0;
+        }
+    }
+    uint64_t end_ns = monotonic_ns();
+    pthread_cond_destroy(&barrier.cond);
+    pthread_mutex_destroy(&barrier.mutex);
+    return (end_ns - barrier.start_ns) / 1e9;
+}
+
+#endif